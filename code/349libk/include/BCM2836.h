@@ -19,4 +19,7 @@
 /** @brief the kernel entry point after the GPU is done booting */
 #define KERN_BASE_PHYSICAL 0x00008000
 
+/** @brief core clock in MHz, converts cycle counts to microseconds */
+#define CPU_MHZ 900
+
 #endif /* _BCM2836_H_ */
\ No newline at end of file
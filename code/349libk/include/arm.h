@@ -47,4 +47,151 @@ void enable_interrupts(void);
  */
 void disable_interrupts(void);
 
+/**
+ * @brief enables the PMU cycle counter and allows user mode to read it
+ */
+void pmu_init(void);
+
+/**
+ * @brief reads the PMU cycle counter
+ * @return the number of cycles counted since pmu_init()
+ */
+uint32_t read_cycle_count(void);
+
+/**
+ * @brief reads the number of the calling core from MPIDR
+ * @return the core number, 0 to 3
+ */
+uint32_t get_core_id(void);
+
+/**
+ * @brief wakes every core waiting in wait_event(), after a dsb
+ */
+void send_event(void);
+
+/**
+ * @brief sleeps the calling core until an event or interrupt
+ */
+void wait_event(void);
+
+/**
+ * @brief takes a spin lock with ldrex/strex, needs the MMU on
+ *
+ * @param lock the lock word, 0 when free
+ */
+void spin_lock(volatile uint32_t *lock);
+
+/**
+ * @brief releases a spin lock taken by spin_lock() and wakes waiters
+ *
+ * @param lock the lock word
+ */
+void spin_unlock(volatile uint32_t *lock);
+
+/**
+ * @brief atomically replaces *addr with new_val if it still holds old_val,
+ *        full barrier on both sides, needs the MMU on
+ *
+ * @param addr    the word to update
+ * @param old_val value *addr must hold
+ * @param new_val value to store
+ * @return 1 if the word was replaced, 0 if it held something else
+ */
+int compare_and_swap(volatile uint32_t *addr, uint32_t old_val,
+                     uint32_t new_val);
+
+/**
+ * @brief orders memory accesses before and after the call across cores
+ */
+void memory_barrier(void);
+
+/**
+ * @brief turns on the MMU, caches and branch prediction of the calling
+ *        core and joins it to the SMP coherency domain
+ *
+ * @param table 16kB aligned first level translation table
+ */
+void mmu_enable(uint32_t *table);
+
+/**
+ * @brief reads the frequency of the generic timer
+ * @return ticks per second
+ */
+uint32_t gtimer_freq(void);
+
+/**
+ * @brief fires the calling core's virtual generic timer irq after the
+ *        given number of ticks, rearming also acknowledges the irq
+ *
+ * @param ticks ticks from now
+ */
+void gtimer_set(uint32_t ticks);
+
+/**
+ * @brief raises the calling core's PMU irq after the given number of
+ *        cycles, counted on event counter 0 so the cycle counter is left
+ *        alone; rearming also acknowledges the irq
+ *
+ * @param cycles cycles from now
+ */
+void pmu_sample_set(uint32_t cycles);
+
+/**
+ * @brief stops the counter and irq pmu_sample_set() started
+ */
+void pmu_sample_stop(void);
+
+/**
+ * @brief Determines if event counter 0 has overflowed
+ *
+ * @return 1 if the overflow irq is pending, 0 if not
+ */
+int pmu_sample_pending(void);
+
+/**
+ * @brief sets the calling core's user read-only thread id register
+ *
+ * @param value what user mode reads from TPIDRURO
+ */
+void write_tpidruro(uint32_t value);
+
+/** @brief FPEXC.EN, VFP and NEON instructions trap as undefined without it */
+#define FPEXC_EN 0x40000000
+
+/** @brief words vfp_save() writes: d0-d31 and the FPSCR */
+#define VFP_REG_NUM 65
+
+/**
+ * @brief gives the calling core access to VFP and NEON, but leaves them
+ *        disabled in FPEXC
+ */
+void vfp_init(void);
+
+/**
+ * @brief reads the VFP exception register
+ * @return FPEXC
+ */
+uint32_t read_fpexc(void);
+
+/**
+ * @brief writes the VFP exception register, FPEXC_EN turns the FPU on
+ *
+ * @param fpexc new FPEXC
+ */
+void write_fpexc(uint32_t fpexc);
+
+/**
+ * @brief stores d0-d31 and the FPSCR, the FPU must be enabled
+ *
+ * @param regs VFP_REG_NUM words
+ */
+void vfp_save(uint32_t *regs);
+
+/**
+ * @brief loads d0-d31 and the FPSCR, the FPU must be enabled
+ *
+ * @param regs VFP_REG_NUM words written by vfp_save()
+ */
+void vfp_restore(uint32_t *regs);
+
 #endif /* _ARM_H_ */
@@ -3,6 +3,10 @@
  *
  * @brief  Definitions for SWI numbers used by kernel and newlib syscalls.
  *
+ *         A syscall is `swi #0` with its number in r7, its arguments in
+ *         r0-r4 and its result returned in r0. Every other register is
+ *         preserved.
+ *
  * @date   September 25, 2015
  * @author Kenneth Li <kyli@andrew.cmu.edu>
  */
@@ -52,6 +56,43 @@
 #define SWI_PRIORITY    18
 /** @brief SWI number for spin_wait() */
 #define SWI_SPIN_WAIT   19
+/** @brief SWI number for scheduler_set_policy() */
+#define SWI_SCHD_POLICY 20
+/** @brief SWI number for scheduler_admit() */
+#define SWI_SCHD_ADMIT 21
+/** @brief SWI number for thread_exit() */
+#define SWI_THR_EXIT   22
+/** @brief SWI number for server_create() */
+#define SWI_SRV_CREATE 23
+/** @brief SWI number for aperiodic_submit() */
+#define SWI_APER_SUBMIT 24
+/** @brief SWI number for the server loop's aperiodic_next() */
+#define SWI_APER_NEXT  25
+/** @brief SWI number for thread_set_overrun() */
+#define SWI_THR_OVERRUN 26
+/** @brief SWI number for thread_stats() */
+#define SWI_THR_STATS  27
+/** @brief SWI number for work_submit() */
+#define SWI_WORK_SUBMIT 28
+/** @brief SWI number for work_take() */
+#define SWI_WORK_TAKE  29
+/** @brief SWI number for thread_set_kstack() */
+#define SWI_THR_KSTACK 30
+/** @brief SWI number for trace_dump() */
+#define SWI_TRACE_DUMP 31
+/** @brief SWI number for thread_hist() */
+#define SWI_THR_HIST   32
+/** @brief SWI number for hist_dump() */
+#define SWI_HIST_DUMP  33
+/** @brief SWI number for profile_start() */
+#define SWI_PROF_START 34
+/** @brief SWI number for profile_dump() */
+#define SWI_PROF_DUMP  35
+/** @brief SWI number for thread_hold() */
+#define SWI_THR_HOLD   36
+
+/** @brief number of SWI numbers, the kernel rejects anything above */
+#define SWI_NUM        37
 
 
 #endif /* _SWI_NUM_H_ */
@@ -0,0 +1,51 @@
+/**
+ * @file   user_page.h
+ *
+ * @brief  Layout of the page the kernel shares read-only with user mode, so
+ *         get_time() and get_priority() need no syscall. Each core has its
+ *         own record; TPIDRURO holds the user address of the calling core's.
+ *
+ *         The kernel makes seq odd while it updates a record and even again
+ *         once it is done. A reader retries until it saw the same even seq
+ *         before and after reading the fields.
+ *
+ * @date   10.15.2026
+ * @author yanyingz
+ */
+
+#ifndef _USER_PAGE_H_
+#define _USER_PAGE_H_
+
+#include <BCM2836.h>
+
+/** @brief user address of the page, the section after the peripherals */
+#define USER_PAGE_ADDR 0x41000000
+
+/** @brief low word of the 64-bit 1MHz system timer counter, readable from
+ *         user mode; the high word follows it */
+#define USER_CLOCK_ADDR (MMIO_BASE_PHYSICAL + 0x3004)
+
+/** @brief records in the page, one per core */
+#define USER_PAGE_CORES 4
+
+#ifndef ASSEMBLER
+
+/** @brief what one core publishes, half a cache line */
+typedef struct {
+  unsigned int seq;           /**< odd while the kernel updates the record */
+  unsigned int time;          /**< scheduler time in ms */
+  unsigned int stamp;         /**< system timer at the ms boundary `time` */
+  unsigned int tickless;      /**< 1 if time only moves on events, add the
+                                   timer's progress since stamp */
+  unsigned int priority;      /**< effective priority of the running thread */
+  unsigned int reserved[3];
+} user_core_page_t;
+
+/** @brief the shared page */
+typedef struct {
+  user_core_page_t core[USER_PAGE_CORES];
+} user_page_t;
+
+#endif /* ASSEMBLER */
+
+#endif /* _USER_PAGE_H_ */
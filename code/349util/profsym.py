@@ -0,0 +1,116 @@
+#!/usr/bin/env python3
+"""Symbolize the kernel profiler's samples.
+
+Build the kernel with -DPROFILE, have the program call profile_start() and
+later profile_dump(), and capture the UART output. Then
+
+    349util/profsym.py capture.txt kernel/kernel.asm lab3_test1/user.asm
+
+prints the hottest functions overall and per thread. The .asm files are
+the objdump listings the Makefile writes next to kernel.elf and user.elf;
+they have to come from the same build as the profiled kernel and program.
+"""
+
+import argparse
+import bisect
+import collections
+import re
+import sys
+
+LABEL = re.compile(r"^([0-9a-f]{8}) <([^>]+)>:$")
+SAMPLE = re.compile(r"prof (\d+) (\d+) (\d+) ([ku]) ([0-9a-f]+) (\d+)")
+END = re.compile(r"prof end (\d+) (\d+)")
+
+IDLE = 0xffff
+
+
+class Symbols:
+    """Function start addresses read from an objdump -D listing."""
+
+    def __init__(self, path):
+        table = {}
+        with open(path) as f:
+            for line in f:
+                m = LABEL.match(line.strip())
+                if m:
+                    table[int(m.group(1), 16)] = m.group(2)
+        self.addrs = sorted(table)
+        self.names = [table[a] for a in self.addrs]
+
+    def lookup(self, pc):
+        i = bisect.bisect_right(self.addrs, pc) - 1
+        if i < 0:
+            return "0x%08x" % pc
+        return self.names[i]
+
+
+def read_samples(path):
+    samples = []
+    dropped = 0
+    with open(path, errors="replace") as f:
+        for line in f:
+            m = SAMPLE.search(line)
+            if m:
+                core, tid, prio, mode, pc, count = m.groups()
+                samples.append((int(core), int(tid), int(prio), mode == "k",
+                                int(pc, 16), int(count)))
+                continue
+            m = END.search(line)
+            if m:
+                dropped += int(m.group(2))
+    return samples, dropped
+
+
+def thread_name(tid):
+    return "idle" if tid == IDLE else "thread %d" % tid
+
+
+def print_top(funcs, total, limit, indent):
+    for (kernel, name), n in funcs.most_common(limit):
+        print("%s%6.2f%%  %-6s %s" % (indent, 100.0 * n / total,
+                                      "kernel" if kernel else "user", name))
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("capture", help="UART output holding profile_dump()")
+    parser.add_argument("kernel_asm", help="kernel.asm of the profiled kernel")
+    parser.add_argument("user_asm", help="user.asm of the profiled program")
+    parser.add_argument("-n", type=int, default=10,
+                        help="functions to list per section (default 10)")
+    args = parser.parse_args(argv[1:])
+
+    samples, dropped = read_samples(args.capture)
+    if not samples:
+        sys.stderr.write("no profiler samples in %s\n" % args.capture)
+        return 1
+    kernel = Symbols(args.kernel_asm)
+    user = Symbols(args.user_asm)
+
+    overall = collections.Counter()
+    threads = collections.defaultdict(collections.Counter)
+    for core, tid, prio, in_kernel, pc, count in samples:
+        name = (kernel if in_kernel else user).lookup(pc)
+        overall[(in_kernel, name)] += count
+        threads[(tid, prio)][(in_kernel, name)] += count
+
+    total = sum(overall.values())
+    print("%d samples, %d dropped" % (total, dropped))
+    print("")
+    print("hottest functions:")
+    print_top(overall, total, args.n, "  ")
+
+    by_load = sorted(threads.items(), key=lambda t: -sum(t[1].values()))
+    for (tid, prio), funcs in by_load:
+        n = sum(funcs.values())
+        in_kernel = sum(c for (k, _), c in funcs.items() if k)
+        print("")
+        print("%s at priority %d: %.2f%% of samples, %.2f%% of them in the "
+              "kernel" % (thread_name(tid), prio, 100.0 * n / total,
+                          100.0 * in_kernel / n))
+        print_top(funcs, n, args.n, "  ")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
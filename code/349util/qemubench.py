@@ -0,0 +1,150 @@
+#!/usr/bin/env python3
+"""Run the kernel microbenchmarks under QEMU and compare them to a baseline.
+
+From the code directory,
+
+    349util/qemubench.py -o bench.txt
+    349util/qemubench.py --baseline bench.txt
+
+builds every lab3_bench_* program of the suite with a -DTICKLESS kernel,
+runs it on QEMU's raspi2b through `make qemu` until it has printed each of
+its reports, and prints the results. With --baseline, a median or p99 that
+grew by more than the tolerance over the baseline run fails the run. Under
+-icount the cycle counter counts instructions, so the numbers are stable
+from run to run but are not the cycle counts of the hardware.
+"""
+
+import argparse
+import os
+import re
+import signal
+import subprocess
+import sys
+
+# the reports each program prints once per round
+SUITE = {
+    "lab3_bench_syscall": ["syscall_null", "syscall_unknown", "user_page"],
+    "lab3_bench_switch": ["irq_to_dispatch", "context_switch"],
+    "lab3_bench_mutex": ["lock", "unlock", "lock_contended",
+                         "unlock_contended"],
+}
+
+KERNEL_FLAGS = "-g -DTICKLESS"
+
+REPORT = re.compile(r"bench (\S+) n (\d+) min (\d+) median (\d+) "
+                    r"p99 (\d+) max (\d+)")
+RESULT = re.compile(r"(\S+) (\S+) n (\d+) min (\d+) median (\d+) "
+                    r"p99 (\d+) max (\d+)")
+FIELDS = ("n", "min", "median", "p99", "max")
+
+
+def make(*args):
+    cmd = ["make", "-s"] + list(args)
+    if subprocess.call(cmd, stdout=subprocess.DEVNULL) != 0:
+        raise RuntimeError("%s failed" % " ".join(cmd))
+
+
+def run(proj, timeout):
+    """Build and boot one program, return {report: {field: value}} from
+    the first round of its reports."""
+    flags = "PROJECT_CCFLAGS=%s" % KERNEL_FLAGS
+    make("clean", "USER_PROJ=" + proj)
+    make("USER_PROJ=" + proj, flags)
+    want = set(SUITE[proj])
+    results = {}
+    qemu = subprocess.Popen(["make", "-s", "qemu", "USER_PROJ=" + proj, flags],
+                            stdout=subprocess.PIPE, universal_newlines=True,
+                            start_new_session=True)
+    signal.signal(signal.SIGALRM, lambda *_: os.killpg(qemu.pid,
+                                                       signal.SIGKILL))
+    signal.alarm(timeout)
+    try:
+        for line in qemu.stdout:
+            m = REPORT.search(line)
+            if m and m.group(1) in want:
+                results[m.group(1)] = dict(zip(FIELDS,
+                                               map(int, m.groups()[1:])))
+                if len(results) == len(want):
+                    break
+    finally:
+        signal.alarm(0)
+        try:
+            os.killpg(qemu.pid, signal.SIGKILL)
+        except ProcessLookupError:
+            pass
+        qemu.wait()
+    missing = want - set(results)
+    if missing:
+        raise RuntimeError("%s: no report for %s within %d s"
+                           % (proj, ", ".join(sorted(missing)), timeout))
+    return results
+
+
+def read_results(path):
+    results = {}
+    with open(path) as f:
+        for line in f:
+            m = RESULT.match(line.strip())
+            if m:
+                results[(m.group(1), m.group(2))] = dict(
+                    zip(FIELDS, map(int, m.groups()[2:])))
+    return results
+
+
+def format_result(proj, name, r):
+    return "%s %s %s" % (proj, name, " ".join("%s %d" % (f, r[f])
+                                             for f in FIELDS))
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("projects", nargs="*", default=sorted(SUITE),
+                        help="programs to run (default: the whole suite)")
+    parser.add_argument("-o", "--output", help="write the results here")
+    parser.add_argument("--baseline", help="results of an earlier run")
+    parser.add_argument("--tolerance", type=float, default=0.05,
+                        help="allowed growth of median and p99 over the "
+                             "baseline (default 0.05)")
+    parser.add_argument("--timeout", type=int, default=300,
+                        help="seconds to wait for each program (default 300)")
+    args = parser.parse_args(argv[1:])
+
+    for proj in args.projects:
+        if proj not in SUITE:
+            sys.stderr.write("%s is not in the suite\n" % proj)
+            return 2
+    baseline = read_results(args.baseline) if args.baseline else {}
+
+    lines = []
+    regressions = 0
+    for proj in args.projects:
+        try:
+            results = run(proj, args.timeout)
+        except RuntimeError as e:
+            sys.stderr.write("%s\n" % e)
+            return 2
+        for name in SUITE[proj]:
+            r = results[name]
+            line = format_result(proj, name, r)
+            base = baseline.get((proj, name))
+            if base is not None:
+                worse = [f for f in ("median", "p99")
+                         if r[f] > base[f] * (1 + args.tolerance)]
+                if worse:
+                    regressions += 1
+                    line += "  REGRESSION %s" % ", ".join(
+                        "%s %d -> %d" % (f, base[f], r[f]) for f in worse)
+            print(line)
+            lines.append(format_result(proj, name, r))
+
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write("\n".join(lines) + "\n")
+    if regressions:
+        print("%d regressions" % regressions)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,170 @@
+#!/usr/bin/env python3
+"""Convert kernel trace dumps into Chrome trace JSON.
+
+Capture the UART output of a program that calls trace_dump() (a kernel built
+with -DTRACE), e.g. with `cat /dev/ttyUSB0 > capture.bin`, then run
+
+    349util/trace2json.py capture.bin trace.json
+
+and open trace.json in chrome://tracing or ui.perfetto.dev. Every core is a
+process with one track per thread, one for IRQs and counters for the system
+ceiling and effective priorities. A capture may hold several dumps and
+ordinary console output around them.
+"""
+
+import json
+import struct
+import sys
+
+MAGIC = b"TRC1"
+
+SWITCH, RELEASE, COMPLETE, MUTEX_LOCK, MUTEX_UNLOCK, CEILING, PRIORITY, \
+    IRQ_ENTER, IRQ_EXIT = range(1, 10)
+
+IDLE = 0xffff
+IRQ_TID = 0x10000
+NO_CEILING = 256
+
+
+class Reader:
+    def __init__(self, data, pos):
+        self.data = data
+        self.pos = pos
+
+    def word(self):
+        if self.pos + 4 > len(self.data):
+            raise EOFError("capture ends inside a dump")
+        (w,) = struct.unpack_from("<I", self.data, self.pos)
+        self.pos += 4
+        return w
+
+
+def unwrap(events, sync_index, sync_cycles):
+    """Extend 32-bit cycle stamps to 64 bits, relative to the sync event.
+
+    Gaps between consecutive events of a core must stay below 2^32 cycles,
+    about 4.7 s at 900 MHz, or the gap comes out 2^32 cycles short. Every
+    IRQ is traced, so the periodic tick keeps them at 1 ms. Under TICKLESS
+    the other cores still tick and core 0 wakes at least every
+    TICKLESS_MAX_SLEEP (1 s) even when idle; a kernel that lets a core
+    sleep longer must trace a sync event before that.
+    """
+    stamps = [0] * len(events)
+    if not events:
+        return stamps
+    stamps[sync_index] = 0
+    for i in range(sync_index + 1, len(events)):
+        stamps[i] = stamps[i - 1] + ((events[i][0] - events[i - 1][0]) & 0xffffffff)
+    for i in range(sync_index - 1, -1, -1):
+        stamps[i] = stamps[i + 1] - ((events[i + 1][0] - events[i][0]) & 0xffffffff)
+    return stamps
+
+
+def parse(data):
+    """Yield (core, us, type, arg) for every event of every dump."""
+    pos = data.find(MAGIC)
+    while pos >= 0:
+        r = Reader(data, pos + len(MAGIC))
+        mhz = r.word()
+        cores = r.word()
+        for core in range(cores):
+            sync_index = r.word()
+            sync_cycles = r.word()
+            sync_us = r.word()
+            count = r.word()
+            events = []
+            for _ in range(count):
+                cycles = r.word()
+                word = r.word()
+                events.append((cycles, word >> 16, word & 0xffff))
+            if events and events[sync_index][0] != sync_cycles:
+                raise ValueError("core %d: sync pair does not match" % core)
+            stamps = unwrap(events, sync_index, sync_cycles)
+            for (cycles, kind, arg), stamp in zip(events, stamps):
+                yield core, sync_us + stamp / mhz, kind, arg
+        pos = data.find(MAGIC, r.pos)
+
+
+def thread_name(tid):
+    if tid == IDLE:
+        return "idle"
+    if tid == IRQ_TID:
+        return "irq"
+    return "thread %d" % tid
+
+
+def convert(events):
+    out = []
+    running = {}
+    tracks = set()
+
+    def track(core, tid):
+        tracks.add((core, tid))
+
+    last = {}
+    for core, us, kind, arg in sorted(events, key=lambda e: e[1]):
+        last[core] = us
+        if kind == SWITCH:
+            prev = running.get(core)
+            if prev is not None:
+                tid, start = prev
+                out.append({"name": thread_name(tid), "ph": "X", "pid": core,
+                            "tid": tid, "ts": start, "dur": us - start})
+            running[core] = (arg, us)
+            track(core, arg)
+        elif kind in (RELEASE, COMPLETE):
+            out.append({"name": "release" if kind == RELEASE else "complete",
+                        "ph": "i", "s": "t", "pid": core, "tid": arg,
+                        "ts": us})
+            track(core, arg)
+        elif kind in (MUTEX_LOCK, MUTEX_UNLOCK):
+            tid = arg >> 8
+            out.append({"name": "mutex %d" % (arg & 0xff),
+                        "ph": "B" if kind == MUTEX_LOCK else "E",
+                        "pid": core, "tid": tid, "ts": us})
+            track(core, tid)
+        elif kind == CEILING:
+            out.append({"name": "system ceiling", "ph": "C", "pid": core,
+                        "ts": us, "args": {
+                            "ceiling": -1 if arg >= NO_CEILING else arg}})
+        elif kind == PRIORITY:
+            out.append({"name": "priority %s" % thread_name(arg & 0xff),
+                        "ph": "C", "pid": core, "ts": us,
+                        "args": {"priority": arg >> 8}})
+        elif kind in (IRQ_ENTER, IRQ_EXIT):
+            out.append({"name": "irq", "ph": "B" if kind == IRQ_ENTER else "E",
+                        "pid": core, "tid": IRQ_TID, "ts": us})
+            track(core, IRQ_TID)
+
+    # the thread running when the dump was taken ends with the last event
+    for core, (tid, start) in running.items():
+        out.append({"name": thread_name(tid), "ph": "X", "pid": core,
+                    "tid": tid, "ts": start, "dur": last[core] - start})
+
+    for core in sorted({c for c, _ in tracks} | set(running)):
+        out.append({"name": "process_name", "ph": "M", "pid": core,
+                    "args": {"name": "core %d" % core}})
+    for core, tid in sorted(tracks):
+        out.append({"name": "thread_name", "ph": "M", "pid": core,
+                    "tid": tid, "args": {"name": thread_name(tid)}})
+    return {"traceEvents": out, "displayTimeUnit": "ns"}
+
+
+def main(argv):
+    if len(argv) != 3:
+        sys.stderr.write("usage: %s capture.bin trace.json\n" % argv[0])
+        return 1
+    with open(argv[1], "rb") as f:
+        data = f.read()
+    events = list(parse(data))
+    if not events:
+        sys.stderr.write("no trace dump found in %s\n" % argv[1])
+        return 1
+    with open(argv[2], "w") as f:
+        json.dump(convert(events), f)
+    print("%d events" % len(events))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -20,6 +20,19 @@
 
 # Enable debug symbols
 PROJECT_CCFLAGS = -g
+# Uncomment to run the scheduler tickless: the BCM system timer is programmed
+# for the next release or budget expiry instead of interrupting every 1 ms
+#PROJECT_CCFLAGS += -DTICKLESS
+# Uncomment to run tasks on all four cores: scheduler_start partitions them
+# first-fit by utilization, core 0 keeps the timer above and cores 1-3 tick
+# from their generic timers
+#PROJECT_CCFLAGS += -DSMP
+# Uncomment to record scheduler events into per-core rings, trace_dump()
+# sends them over UART for 349util/trace2json.py
+#PROJECT_CCFLAGS += -DTRACE
+# Uncomment to build the PMU sampling profiler, profile_start() and
+# profile_dump() drive it and 349util/profsym.py reads its output
+#PROJECT_CCFLAGS += -DPROFILE
 
 ###########################################################################
 # Kernel include directories
@@ -39,13 +52,21 @@ K_C_SRC += 349libk/src/leds.c
 K_C_SRC += 349libk/src/gpio.c
 K_C_SRC += $(PROJECT)/src/ads1015.c
 K_C_SRC += $(PROJECT)/src/i2c.c
+K_C_SRC += $(PROJECT)/src/bitmap.c
+K_C_SRC += $(PROJECT)/src/deque.c
+K_C_SRC += $(PROJECT)/src/heap.c
+K_C_SRC += $(PROJECT)/src/mmu.c
 K_C_SRC += $(PROJECT)/src/screen.c
+K_C_SRC += $(PROJECT)/src/smp.c
 K_C_SRC += $(PROJECT)/src/spi.c
 K_C_SRC += $(PROJECT)/src/syscall_thread.c
 K_C_SRC += $(PROJECT)/src/syscalls.c
 K_C_SRC += $(PROJECT)/src/kernel.c
 K_C_SRC += $(PROJECT)/src/printk.c
+K_C_SRC += $(PROJECT)/src/profile.c
 K_C_SRC += $(PROJECT)/src/timer.c
+K_C_SRC += $(PROJECT)/src/trace.c
+K_C_SRC += $(PROJECT)/src/systimer.c
 K_C_SRC += $(PROJECT)/src/uart.c
 
 ###########################################################################
@@ -0,0 +1,79 @@
+/**
+ * @file   bitmap.h
+ *
+ * @brief  Two-level bitmap of 256 bits with constant time search. A summary
+ *         word marks the non-empty words below it, so the lowest set bit is
+ *         found with two clz. Used for priority levels and free ids, where
+ *         bit 0 is the highest priority.
+ *
+ * @date   10.15.2026
+ * @author yanyingz
+ */
+
+#ifndef _BITMAP_H_
+#define _BITMAP_H_
+
+#include <kstdint.h>
+
+/** @brief number of bits */
+#define BITMAP_BITS	256
+/** @brief returned by the searches when no bit is set */
+#define BITMAP_NONE	BITMAP_BITS
+
+/** @brief bit `i` is bit i % 32 of word[i / 32], summary bit w is set
+ *         when word[w] is not zero */
+typedef struct bitmap {
+  uint32_t summary;
+  uint32_t word[BITMAP_BITS / 32];
+} bitmap_t;
+
+/**
+ * @brief Clears every bit
+ *
+ * @param b the bitmap
+ */
+void bitmap_init(bitmap_t *b);
+
+/**
+ * @brief Sets bit i
+ *
+ * @param b the bitmap
+ * @param i bit to set, less than BITMAP_BITS
+ */
+void bitmap_set(bitmap_t *b, uint32_t i);
+
+/**
+ * @brief Clears bit i
+ *
+ * @param b the bitmap
+ * @param i bit to clear, less than BITMAP_BITS
+ */
+void bitmap_clear(bitmap_t *b, uint32_t i);
+
+/**
+ * @brief Checks bit i
+ *
+ * @param b the bitmap
+ * @param i bit to check, less than BITMAP_BITS
+ * @return 1 if set, 0 if not
+ */
+int bitmap_test(bitmap_t *b, uint32_t i);
+
+/**
+ * @brief Lowest set bit. O(1).
+ *
+ * @param b the bitmap
+ * @return the bit, or BITMAP_NONE if the bitmap is empty
+ */
+uint32_t bitmap_first(bitmap_t *b);
+
+/**
+ * @brief Lowest set bit at or above i. O(1).
+ *
+ * @param b the bitmap
+ * @param i first bit to consider
+ * @return the bit, or BITMAP_NONE if there is none
+ */
+uint32_t bitmap_next(bitmap_t *b, uint32_t i);
+
+#endif /* _BITMAP_H_ */
@@ -0,0 +1,69 @@
+/**
+ * @file   deque.h
+ *
+ * @brief  Bounded lock-free work-stealing deque (Chase-Lev). One core owns
+ *         the deque and pushes and pops at the bottom, any other core may
+ *         steal from the top. Owner operations must not interleave with
+ *         each other, so the owner masks IRQs around them.
+ *
+ * @date   10.15.2026
+ * @author yanyingz
+ */
+
+#ifndef _DEQUE_H_
+#define _DEQUE_H_
+
+#include <kstdint.h>
+
+/** @brief number of entries, must be a power of two */
+#define DEQUE_SIZE	64
+
+/** @brief a unit of work, fn(arg) */
+typedef struct deque_entry {
+  void (*fn)(void *arg);
+  void *arg;
+} deque_entry_t;
+
+/** @brief indices only grow, their difference is the number of entries */
+typedef struct deque {
+  volatile uint32_t top;
+  volatile uint32_t bottom;
+  deque_entry_t entry[DEQUE_SIZE];
+} deque_t;
+
+/**
+ * @brief Empties the deque
+ *
+ * @param d the deque to initialize
+ */
+void deque_init(deque_t *d);
+
+/**
+ * @brief Pushes an entry at the bottom, owner only
+ *
+ * @param d     the deque
+ * @param entry entry to copy in
+ * @return 0 on success, -1 if the deque is full
+ */
+int deque_push(deque_t *d, deque_entry_t *entry);
+
+/**
+ * @brief Pops the newest entry from the bottom, owner only
+ *
+ * @param d     the deque
+ * @param entry filled with the entry
+ * @return 0 on success, -1 if the deque is empty or a thief took the
+ *         last entry
+ */
+int deque_pop(deque_t *d, deque_entry_t *entry);
+
+/**
+ * @brief Steals the oldest entry from the top, safe from any core
+ *
+ * @param d     the deque
+ * @param entry filled with the entry
+ * @return 0 on success, -1 if the deque is empty or another core won
+ */
+int deque_steal(deque_t *d, deque_entry_t *entry);
+
+#endif /* _DEQUE_H_ */
@@ -0,0 +1,103 @@
+/**
+ * @file   heap.h
+ *
+ * @brief  Binary min-heap of (key, id) pairs used for the scheduler queues.
+ *         Ids are thread ids, so every id can be looked up or removed
+ *         without searching the heap.
+ *
+ * @date   10.15.2026
+ * @author yanyingz
+ */
+
+#ifndef _HEAP_H_
+#define _HEAP_H_
+
+#include <kstdint.h>
+
+/** @brief maximum number of entries, one per thread id */
+#define HEAP_SIZE	256
+/** @brief position of an id that is not in the heap */
+#define HEAP_NONE	0xffffffff
+
+/** @brief filter for heap_min_match, nonzero to accept an id */
+typedef int (*heap_match_fn)(uint32_t id, void *arg);
+
+/** @brief min-heap ordered by key, ties broken by lower id */
+typedef struct heap {
+  uint32_t key[HEAP_SIZE];
+  uint32_t id[HEAP_SIZE];
+  uint32_t pos[HEAP_SIZE];
+  uint32_t size;
+} heap_t;
+
+/**
+ * @brief Empties the heap
+ *
+ * @param h the heap to initialize
+ */
+void heap_init(heap_t *h);
+
+/**
+ * @brief Inserts an id with the given key, replacing its old key if the id
+ *        is already in the heap. O(log n).
+ *
+ * @param h   the heap
+ * @param id  id to insert, must be less than HEAP_SIZE
+ * @param key ordering key
+ */
+void heap_insert(heap_t *h, uint32_t id, uint32_t key);
+
+/**
+ * @brief Removes an id from the heap if it is there. O(log n).
+ *
+ * @param h  the heap
+ * @param id id to remove
+ */
+void heap_remove(heap_t *h, uint32_t id);
+
+/**
+ * @brief Checks whether an id is in the heap
+ *
+ * @param h  the heap
+ * @param id id to look for
+ * @return 1 if the id is in the heap, 0 if not
+ */
+int heap_contains(heap_t *h, uint32_t id);
+
+/**
+ * @brief Checks whether the heap is empty
+ *
+ * @param h the heap
+ * @return 1 if empty, 0 if not
+ */
+int heap_empty(heap_t *h);
+
+/**
+ * @brief Id with the smallest key, the heap must not be empty
+ *
+ * @param h the heap
+ * @return the id at the top of the heap
+ */
+uint32_t heap_min_id(heap_t *h);
+
+/**
+ * @brief Smallest key in the heap, the heap must not be empty
+ *
+ * @param h the heap
+ * @return the key at the top of the heap
+ */
+uint32_t heap_min_key(heap_t *h);
+
+/**
+ * @brief Id with the smallest key among the ones a filter accepts. Only
+ *        the entries smaller than that one and their children are
+ *        visited.
+ *
+ * @param h     the heap
+ * @param match the filter
+ * @param arg   passed on to match
+ * @return the id, HEAP_NONE if the filter accepts none
+ */
+uint32_t heap_min_match(heap_t *h, heap_match_fn match, void *arg);
+
+#endif /* _HEAP_H_ */
@@ -0,0 +1,31 @@
+/**
+ * @file   mmu.h
+ *
+ * @brief  Identity mapped first level translation table. RAM is normal
+ *         write-back memory shared between the cores, so caches and the
+ *         ldrex/strex exclusive monitors work; the peripherals are device
+ *         memory. One page of kernel memory is also mapped read-only
+ *         above the peripherals for user mode to read.
+ *
+ * @date   10.15.2026
+ * @author yanyingz
+ */
+
+#ifndef _MMU_H_
+#define _MMU_H_
+
+/**
+ * @brief Builds the translation table and turns the MMU on for core 0
+ *
+ * @param user_page 4kB aligned page also mapped read-only for user mode at
+ *                  USER_PAGE_ADDR
+ */
+void mmu_init(void *user_page);
+
+/**
+ * @brief Turns the MMU on for the calling core with the table built by
+ *        mmu_init()
+ */
+void mmu_start(void);
+
+#endif /* _MMU_H_ */
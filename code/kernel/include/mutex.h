@@ -12,6 +12,8 @@ typedef struct mutex_t {
   int lock;
   unsigned int ceiling;
   int thread;
+  unsigned int waiters;
+  unsigned int id;
 } mutex_t;
 
 #endif // __MUTEX_TYPE_H
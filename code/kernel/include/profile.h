@@ -0,0 +1,79 @@
+/**
+ * @file   profile.h
+ *
+ * @brief  Sampling profiler. PMU event counter 0 interrupts every core
+ *         after a set number of cycles; the interrupted pc is counted
+ *         against the running thread and its effective priority in a
+ *         per-core table. profile_dump() prints the tables over UART and
+ *         349util/profsym.py symbolizes them against the kernel.asm and
+ *         user.asm listings the Makefile writes. Code running with IRQs
+ *         masked is charged to the instruction that unmasks them. Without
+ *         -DPROFILE only the syscalls remain, and they fail.
+ *
+ * @date   10.16.2026
+ * @author yanyingz
+ */
+
+#ifndef _PROFILE_H_
+#define _PROFILE_H_
+
+#include <kstdint.h>
+
+/** @brief distinct (thread, pc) pairs each core counts, a power of two */
+#define PROFILE_SLOTS	1024
+
+/** @brief shortest interval between samples, 10 us at 900 MHz */
+#define PROFILE_MIN_CYCLES	9000
+
+/** @brief samples of one pc in one thread */
+typedef struct profile_slot {
+  uint32_t pc;        /**< interrupted instruction */
+  uint16_t tid;       /**< thread id, 0xffff for idle */
+  uint8_t priority;   /**< effective priority at the sample */
+  uint8_t kernel;     /**< 1 if the thread was in the kernel */
+  uint32_t count;     /**< samples, 0 marks a free slot */
+} profile_slot_t;
+
+#ifdef PROFILE
+/**
+ * @brief Called first on every IRQ: applies a profile_start() made on
+ *        another core, and takes a sample if the PMU overflowed
+ *
+ * @param core the calling core
+ * @param sp frame of the interrupted code
+ * @return 1 if this IRQ was a sample, 0 if not
+ */
+int profile_irq(uint32_t core, uint32_t *sp);
+
+/**
+ * @brief Counts one sample on the calling core
+ *
+ * @param pc interrupted instruction
+ * @param tid running thread
+ * @param priority its effective priority
+ * @param kernel 1 if the sample hit the kernel
+ */
+void profile_record(uint32_t pc, uint32_t tid, uint32_t priority,
+                    uint32_t kernel);
+#endif
+
+/**
+ * @brief Starts sampling on every core, or stops it
+ *
+ * @param interval cycles between samples, at least PROFILE_MIN_CYCLES,
+ *        0 to stop
+ * @return 0 on success, -1 for a bad interval or without -DPROFILE
+ */
+int profile_start(unsigned int interval);
+
+/**
+ * @brief Prints every core's samples over UART and empties the tables,
+ *        one "prof <core> <tid> <prio> <k|u> <pc> <count>" line per slot
+ *        and a closing "prof end <samples> <dropped>" line
+ *
+ * @return number of samples printed, -1 without -DPROFILE or while
+ *         another dump is running
+ */
+int profile_dump(void);
+
+#endif /* _PROFILE_H_ */
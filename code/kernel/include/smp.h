@@ -0,0 +1,90 @@
+/**
+ * @file   smp.h
+ *
+ * @brief  Routines for the BCM2836 local peripherals used to run all four
+ *         cores: mailbox 3 releases cores 1-3 at boot, mailbox 0 carries
+ *         reschedule requests between cores, and cores 1-3 take their
+ *         scheduler tick from their own generic timer.
+ *
+ * @date   10.15.2026
+ * @author yanyingz
+ */
+
+#ifndef _SMP_H_
+#define _SMP_H_
+
+#include <kstdint.h>
+
+#ifdef SMP
+/** @brief number of cores the scheduler runs on */
+#define CORE_NUM 4
+#else
+/** @brief number of cores the scheduler runs on */
+#define CORE_NUM 1
+#endif
+
+/**
+ * @brief Releases cores 1 to CORE_NUM-1 into _start_secondary
+ */
+void smp_boot(void);
+
+/**
+ * @brief Routes mailbox 0 of the calling core to its IRQ line, and its
+ *        PMU too when the kernel is built with -DPROFILE
+ *
+ * @param core the calling core
+ */
+void smp_irq_init(uint32_t core);
+
+/**
+ * @brief Starts the calling core's periodic generic timer irq
+ *
+ * @param core the calling core
+ * @param freq interrupts per second
+ */
+void smp_timer_start(uint32_t core, uint32_t freq);
+
+/**
+ * @brief Determines if the core's generic timer irq is pending
+ *
+ * @param core the calling core
+ * @return 1 if the timer interrupt is pending, 0 if not.
+ */
+int smp_timer_is_pending(uint32_t core);
+
+/**
+ * @brief Acknowledges the generic timer irq by arming the next period
+ */
+void smp_timer_clear_pending(void);
+
+/**
+ * @brief Asks another core to reschedule
+ *
+ * @param core the core to interrupt
+ */
+void smp_ipi_send(uint32_t core);
+
+/**
+ * @brief Determines if a reschedule request is pending for a core
+ *
+ * @param core the calling core
+ * @return 1 if a request is pending, 0 if not.
+ */
+int smp_ipi_is_pending(uint32_t core);
+
+/**
+ * @brief Acknowledges every pending reschedule request of a core
+ *
+ * @param core the calling core
+ */
+void smp_ipi_clear_pending(uint32_t core);
+
+/**
+ * @brief Determines if anything but the PMU interrupts a core
+ *
+ * @param core the calling core
+ * @return 1 if another interrupt is pending, 0 if not.
+ */
+int smp_irq_other_pending(uint32_t core);
+
+#endif /* _SMP_H_ */
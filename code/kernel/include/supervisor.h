@@ -23,5 +23,11 @@ void install_interrupt_table();
  */
 int enter_user_mode();
 
+/**
+ * @brief Resumes a saved frame, the calling kernel path is abandoned
+ *
+ * @param frame the 20 word frame on top of a thread's kernel stack
+ */
+void idle_enter(uint32_t *frame);
 
 #endif /* _SUPERVISOR_H_ */
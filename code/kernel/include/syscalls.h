@@ -12,6 +12,8 @@
 
 #include <kstdint.h>
 #include <mutex.h>
+#include <swi_num.h>
+#include <user_page.h>
 
 /** @brief Signature of a thread function
  *
@@ -21,6 +23,59 @@
  */
 typedef void (*thread_fn) (void);
 
+/** @brief Fixed priority scheduling policy */
+#define SCHED_RM  0
+/** @brief Earliest deadline first scheduling policy */
+#define SCHED_EDF 1
+
+/** @brief Most threads alive at once, thread ids are below it */
+#define THREAD_MAX      256
+/** @brief Thread priorities are below it, it is the idle thread's */
+#define THREAD_PRIO_MAX 255
+
+/** @brief Signature of an aperiodic job run by the sporadic server */
+typedef void (*aperiodic_fn) (void *arg);
+
+/** @brief An aperiodic job queued for the sporadic server */
+typedef struct {
+  aperiodic_fn fn;  /**< function to run */
+  void *arg;        /**< its argument */
+} aperiodic_job_t;
+
+/** @brief Overrun policy: suspend the job until its next period */
+#define OVERRUN_SUSPEND 0
+/** @brief Overrun policy: finish the job below every other task */
+#define OVERRUN_DEMOTE  1
+/** @brief Overrun policy: suspend the job and run a handler on the server */
+#define OVERRUN_HANDLER 2
+
+/** @brief Budget enforcement counters of a thread */
+typedef struct {
+  uint32_t overruns;      /**< jobs that ran past their computation time */
+  uint32_t misses;        /**< jobs completed after their deadline or
+                               abandoned by a suspending overrun */
+  uint32_t max_lateness;  /**< worst completion past a deadline (ms) */
+  uint32_t long_holds;    /**< critical sections that ran longer than
+                               thread_hold() declared */
+} thread_stats_t;
+
+/** @brief Buckets of a histogram: bucket 0 counts 0 us, bucket i counts
+ *         values from 2^(i-1) to 2^i - 1 us and the last one everything
+ *         from 2^(HIST_BUCKETS-2) us on */
+#define HIST_BUCKETS 24
+
+/** @brief Log-scale histogram of a time in microseconds */
+typedef struct {
+  uint32_t bucket[HIST_BUCKETS];  /**< samples per bucket */
+  uint32_t max;                   /**< largest sample (us) */
+} hist_t;
+
+/** @brief Timing histograms of a thread's jobs */
+typedef struct {
+  hist_t response;  /**< release to completion */
+  hist_t jitter;    /**< release to first dispatch */
+} thread_hist_t;
+
 
 /**
  * @brief See linux man page for sbrk
@@ -123,9 +178,9 @@ int syscall_sample_adc_stop();
  *  threads or start the scheduler.
  *
  *  @param idle_fn Pointer to a thread function to run when no other threads are
- *  runnable.
+ *  runnable. Every core runs it, pass work_idle to let idle cores run work.
  *  @param idle_stack_start Pointer to the first valid location of idle thread's
- *  stack.
+ *  stack. The idle threads of cores 1-3 get 4KB stacks from the kernel.
  *
  *  @return 0 on success or -1 on failure
  */
@@ -136,15 +191,179 @@ int thread_init(thread_fn idle_fn, uint32_t *idle_stack_start);
  *  @param fn Pointer to the function to run in the new thread.
  *  @param stack_start Pointer to the first valid location of this thread's
  *  stack.
- *  @param prio Priority of this thread. Lower number are higher priority.
+ *  @param prio Priority of this thread, below THREAD_PRIO_MAX. Lower number
+ *  are higher priority.
  *  @param C Real time execution time (ms).
  *  @param T Real time task period (ms).
  *
+ *  Threads that share a priority run first come first served. Every thread
+ *  gets the lowest free id, so ids follow creation order until a thread
+ *  exits. Once the scheduler runs, the thread is only created if the task
+ *  set with it still passes the admission test, and it is first released
+ *  at a safe period boundary.
+ *
  *  @return 0 on success or -1 on failure
  */
 int thread_create(thread_fn fn, uint32_t *stack_start,
                   unsigned int prio, unsigned int C, unsigned int T);
 
+/** @brief Set the kernel stack size of the threads created after this call.
+ *
+ *  Each thread has its own kernel stack for its syscalls, 4KB unless this
+ *  is called. Threads that only use the thread and mutex syscalls fit in
+ *  the minimum of 1KB.
+ *
+ *  @param size bytes, a multiple of 8 from 1KB to 64KB
+ *
+ *  @return 0 on success or -1 on failure
+ */
+int thread_set_kstack(unsigned int size);
+
+/** @brief End the calling thread.
+ *
+ *  The thread must not hold a mutex. Its id can be reused by
+ *  thread_create() once its current period is over.
+ *
+ *  @return -1 on failure, does not return otherwise
+ */
+int thread_exit(void);
+
+/** @brief Create the sporadic server, a thread that runs queued aperiodic
+ *         jobs at priority `prio` with a budget of C ms every T ms.
+ *
+ *  @param fn the user space server loop, which calls aperiodic_next()
+ *  @param stack_start Pointer to the first valid location of the server's
+ *  stack.
+ *  @param prio Priority of the server.
+ *  @param C Server budget (ms).
+ *  @param T Server replenishment period (ms).
+ *
+ *  @return 0 on success or -1 on failure
+ */
+int server_create(thread_fn fn, uint32_t *stack_start,
+                  unsigned int prio, unsigned int C, unsigned int T);
+
+/** @brief Queue an aperiodic job for the sporadic server.
+ *
+ *  @param fn function the server will call
+ *  @param arg argument passed to fn
+ *
+ *  @return 0 on success or -1 if the queue is full or there is no server
+ */
+int aperiodic_submit(aperiodic_fn fn, void *arg);
+
+/** @brief aperiodic_submit() for irq handlers, which reschedule on exit
+ *
+ *  @param fn function the server will call
+ *  @param arg argument passed to fn
+ *
+ *  @return 0 on success or -1 if the queue is full or there is no server
+ */
+int aperiodic_submit_irq(aperiodic_fn fn, void *arg);
+
+/** @brief Take the next aperiodic job, called by the server loop. The
+ *         server is suspended when the queue is empty.
+ *
+ *  @param job filled with the job to run
+ *
+ *  @return 0 if job was filled in, -1 if the caller should call again
+ */
+int aperiodic_next(aperiodic_job_t *job);
+
+/** @brief Choose what happens when a job of thread `tid` runs longer
+ *         than its computation time C.
+ *
+ *  OVERRUN_SUSPEND, the default, stops the job until its next period.
+ *  OVERRUN_DEMOTE lets it carry on only when no other task is runnable,
+ *  until its next period. OVERRUN_HANDLER suspends it and queues
+ *  handler((void *)tid) on the sporadic server. A job that overruns while
+ *  it holds a mutex is only stopped or demoted once it unlocks the last
+ *  one, and a demoted job runs at any priority it inherits meanwhile.
+ *
+ *  @param tid id of the thread
+ *  @param policy one of the OVERRUN_ policies
+ *  @param handler the handler for OVERRUN_HANDLER, ignored otherwise
+ *
+ *  @return 0 on success or -1 on failure
+ */
+int thread_set_overrun(unsigned int tid, unsigned int policy,
+                       aperiodic_fn handler);
+
+/** @brief Declare the longest critical section thread `tid` runs on
+ *         `mutex`, from mutex_lock() to mutex_unlock() and in cpu time.
+ *         The admission tests take the blocking a task can see from these
+ *         declarations and the mutex ceilings. A thread that may lock a
+ *         mutex it declared nothing on is taken to block for its whole
+ *         computation time, so declare 0 us on one it never locks. A
+ *         critical section that runs longer is counted in the thread's
+ *         long_holds. Declaring again replaces the old value.
+ *
+ *  @param tid id of the thread
+ *  @param mutex a mutex the thread may lock under its ceiling
+ *  @param us the critical section in microseconds
+ *
+ *  @return 0 on success, -1 for a bad thread or mutex, for a ninth mutex
+ *          of one thread, or once the scheduler runs, if the tasks the
+ *          section can block would not be schedulable
+ */
+int thread_hold(unsigned int tid, mutex_t *mutex, unsigned int us);
+
+/** @brief Read the budget enforcement counters of thread `tid`.
+ *
+ *  @param tid id of the thread
+ *  @param stats filled with the counters
+ *
+ *  @return 0 on success or -1 on failure
+ */
+int thread_stats(unsigned int tid, thread_stats_t *stats);
+
+/** @brief Read the response time and release jitter histograms of thread
+ *         `tid`. Times are taken on the system timer from the scheduler
+ *         pass that released the job.
+ *
+ *  @param tid id of the thread
+ *  @param hist filled with the histograms
+ *
+ *  @return 0 on success or -1 on failure
+ */
+int thread_hist(unsigned int tid, thread_hist_t *hist);
+
+/** @brief Print the histograms of every thread over UART, one line per
+ *         histogram: "hist <tid> response|jitter max <us>:" followed by the
+ *         HIST_BUCKETS bucket counts.
+ *
+ *  @return number of threads printed
+ */
+int hist_dump(void);
+
+/** @brief Push background work onto the calling core's deque. Idle cores
+ *         run it, taking from their own deque first and stealing from the
+ *         others when it is empty.
+ *
+ *  @param fn function an idle core will call
+ *  @param arg argument passed to fn
+ *
+ *  @return 0 on success or -1 if the deque is full
+ */
+int work_submit(aperiodic_fn fn, void *arg);
+
+/** @brief work_submit() for irq handlers, which already run with IRQs masked
+ *
+ *  @param fn function an idle core will call
+ *  @param arg argument passed to fn
+ *
+ *  @return 0 on success or -1 if the deque is full
+ */
+int work_submit_irq(aperiodic_fn fn, void *arg);
+
+/** @brief Take background work, called by the work_idle loop
+ *
+ *  @param job filled with the work to run
+ *
+ *  @return 0 if job was filled in, -1 if no core had work
+ */
+int work_take(aperiodic_job_t *job);
+
 /** @brief Initialize the mutex
  *
  *  A user program must call this initializer before attempting to lock or
@@ -154,7 +373,9 @@ int thread_create(thread_fn fn, uint32_t *stack_start,
  *  @param mutex The mutex to act on.
  *  @param max_prio The maximum priority of a thread which could use
  *
- *  @return 0 on success or -1 on failure
+ *  @return 0 on success or -1 on failure, also once the scheduler runs
+ *          if the tasks that may lock it would leave the task set
+ *          unschedulable
  */
 int mutex_init(mutex_t *mutex, unsigned int max_prio);
 
@@ -180,12 +401,43 @@ void wait_until_next_period(void);
 /** @brief Get the current time in milliseconds */
 unsigned int get_time(void);
 
+/** @brief Choose the scheduling policy for the task set.
+ *
+ *  SCHED_RM (the default) runs the highest priority thread, with PCP for
+ *  mutexes. SCHED_EDF runs the thread with the earliest absolute deadline,
+ *  with thread priorities used as SRP preemption levels (give shorter
+ *  periods lower numbers) and mutex ceilings expressed in the same
+ *  priorities. Must be called before scheduler_start().
+ *
+ *  @param policy SCHED_RM or SCHED_EDF
+ *
+ *  @return 0 on success or -1 on failure
+ */
+int scheduler_set_policy(unsigned int policy);
+
+/** @brief Run the admission test of the selected policy on the threads
+ *         created so far, without starting the scheduler.
+ *
+ *  Fixed priority uses exact response time analysis including PCP blocking
+ *  and scheduler overhead; EDF reports each thread's period.
+ *
+ *  @param wcrt  array of THREAD_MAX entries filled with the worst case
+ *               response time of each thread id in microseconds, 0 for
+ *               unused ids
+ *
+ *  @return 0 if the task set is schedulable or -1 if not
+ */
+int scheduler_admit(uint32_t *wcrt);
+
 /** @brief Allow the kernel to start running the added task set.
  *
  *  This function should enable IRQs and thus enable your scheduler. The kernel
  *  will test that a task set with this new task is scheduleable before running
  *  and may return an error if this is not the case.
  *
+ *  With more than one core the tasks are first packed onto the cores by
+ *  utilization, each core checked with the admission test.
+ *
  *  @return 0 on success or -1 on failure
  */
 int scheduler_start(void);
@@ -203,6 +455,60 @@ unsigned int get_priority(void);
  */
 void spin_wait(unsigned ms);
 
+/** @brief Wait for scheduler_start() on cores 1-3, then schedule the
+ *         tasks partitioned onto the calling core. Never returns.
+ */
+void scheduler_start_secondary(void);
+
+/** @brief Timer tick: charge the running task the time it ran since the
+ *         last scheduler pass and reschedule
+ *
+ *  @param sp frame of the interrupted task, on its kernel stack
+ *  @return frame of the task to resume, sp itself if it keeps running
+ */
 uint32_t* call_scheduler(uint32_t* sp);
 
+/** @brief Reschedule from a syscall that gave up the cpu, charging the
+ *         calling task the time it ran up to the call
+ *
+ *  @param sp frame of the calling task, on its kernel stack
+ *  @return frame of the task to resume
+ */
+uint32_t* dispatch(uint32_t* sp);
+
+/** @brief Stop charging the calling thread's budget, for syscalls that
+ *         write a dump over UART: they take far longer than any job is
+ *         budgeted for, but on behalf of the tools rather than the task
+ */
+void budget_pause(void);
+
+/** @brief Charge the calling thread's budget again after budget_pause() */
+void budget_resume(void);
+
+/** @brief Page shared read-only with user mode, see user_page.h */
+extern user_page_t user_page;
+
+/** @brief A syscall as swi_table holds it, called with the real arguments */
+typedef void (*swi_fn)(void);
+
+/** @brief Syscalls by SWI number, NULL where there is none */
+extern swi_fn const swi_table[SWI_NUM];
+
+/** @brief Undefined instruction from a thread: if it was a VFP or NEON
+ *         instruction with the FPU off, hand the FPU to the thread
+ *
+ *  Saves the registers of the core's previous FPU user and loads the
+ *  thread's own. Runs in undefined mode with IRQs masked.
+ *
+ *  @return 1 to retry the instruction, 0 if it is really undefined
+ */
+int vfp_trap(void);
+
+/** @brief Profiler sample: count the pc an IRQ interrupted against the
+ *         task running on the calling core
+ *
+ *  @param sp frame of the interrupted code
+ */
+void profile_sample(uint32_t *sp);
+
 #endif /* _SYSCALLS_H_ */
@@ -0,0 +1,48 @@
+/**
+ * @file   systimer.h
+ *
+ * @brief  Routines for the BCM2835 free-running 1 MHz system timer. Compare
+ *         channel 1 is used as a one-shot alarm for the tickless scheduler.
+ *
+ * @date   10.15.2026
+ * @author yanyingz
+ */
+
+#ifndef _SYSTIMER_H_
+#define _SYSTIMER_H_
+
+#include <kstdint.h>
+
+/**
+ * @brief Reads the low 32 bits of the system timer
+ *
+ * @return current counter value in microseconds
+ */
+uint32_t systimer_read(void);
+
+/**
+ * @brief Raises an IRQ when the system timer reaches the given value. An
+ *        alarm that is already due fires as soon as possible.
+ *
+ * @param us counter value at which to fire
+ */
+void systimer_set_alarm(uint32_t us);
+
+/**
+ * @brief Disables the system timer alarm IRQ
+ */
+void systimer_stop(void);
+
+/**
+ * @brief Determines if there is currently a pending alarm interrupt
+ *
+ * @return 1 if the alarm interrupt is pending, 0 if not.
+ */
+int systimer_is_pending(void);
+
+/**
+ * @brief Acknowledges the alarm interrupt
+ */
+void systimer_clear_pending(void);
+
+#endif /* _SYSTIMER_H_ */
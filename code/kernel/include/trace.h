@@ -0,0 +1,84 @@
+/**
+ * @file   trace.h
+ *
+ * @brief  Scheduler event tracing. Every core records into its own ring of
+ *         fixed-size events stamped with its cycle counter, so recording
+ *         takes no lock and costs a few tens of cycles. trace_dump() sends
+ *         the rings over UART in binary, 349util/trace2json.py turns the
+ *         capture into a Chrome/Perfetto trace. Without -DTRACE the hooks
+ *         compile to nothing.
+ *
+ * @date   10.16.2026
+ * @author yanyingz
+ */
+
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <kstdint.h>
+
+/** @brief events kept per core, must be a power of two */
+#define TRACE_EVENTS	2048
+
+/** @brief a thread is dispatched, arg: thread id, 0xffff for idle */
+#define TRACE_SWITCH	1
+/** @brief a periodic job is released, arg: thread id */
+#define TRACE_RELEASE	2
+/** @brief a job completes, arg: thread id */
+#define TRACE_COMPLETE	3
+/** @brief a mutex is taken, arg: mutex id | thread id << 8 */
+#define TRACE_MUTEX_LOCK	4
+/** @brief a mutex is given back, arg: mutex id | thread id << 8 */
+#define TRACE_MUTEX_UNLOCK	5
+/** @brief the system ceiling changed, arg: new ceiling, 256 for none */
+#define TRACE_CEILING	6
+/** @brief an effective priority changed, arg: thread id | priority << 8 */
+#define TRACE_PRIORITY	7
+/** @brief the IRQ handler is entered, arg: 0 */
+#define TRACE_IRQ_ENTER	8
+/** @brief the IRQ handler returns, arg: 0 */
+#define TRACE_IRQ_EXIT	9
+
+/** @brief one recorded event */
+typedef struct trace_event {
+  uint32_t cycles;  /**< cycle counter of the recording core */
+  uint16_t arg;     /**< meaning depends on the type */
+  uint16_t type;    /**< TRACE_* */
+} trace_event_t;
+
+/** @brief ring of one core, only that core writes it */
+typedef struct trace_ring {
+  uint32_t head;         /**< events recorded since the last dump */
+  uint32_t sync_head;    /**< head of the event sync_cycles belongs to */
+  uint32_t sync_cycles;  /**< cycle counter at a system timer reading */
+  uint32_t sync_us;      /**< that system timer reading */
+  trace_event_t event[TRACE_EVENTS];
+} trace_ring_t;
+
+#ifdef TRACE
+/**
+ * @brief Records an event on the calling core. Must run with IRQs masked,
+ *        an IRQ recording on the same core would take the same slot.
+ *
+ * @param type TRACE_* event type
+ * @param arg  event argument, truncated to 16 bits
+ */
+void trace_record(uint32_t type, uint32_t arg);
+
+/** @brief records an event when tracing is compiled in */
+#define trace(type, arg)	trace_record((type), (arg))
+#else
+#define trace(type, arg)
+#endif
+
+/**
+ * @brief Sends every core's events over UART and empties the rings.
+ *        Recording pauses meanwhile; nothing else may print until it
+ *        returns. The caller's budget is not charged while it runs.
+ *
+ * @return number of events sent, -1 without -DTRACE or while another
+ *         dump is running
+ */
+int trace_dump(void);
+
+#endif /* _TRACE_H_ */
@@ -0,0 +1,55 @@
+/**
+ * @file   bitmap.c
+ *
+ * @brief  Implementation of the two-level bitmap
+ *
+ * @date   10.15.2026
+ * @author yanyingz
+ */
+
+#include <kstdint.h>
+#include <bitmap.h>
+
+/**@brief index of the lowest set bit of a non-zero word*/
+static uint32_t lowest_bit(uint32_t w){
+  return 31 - __builtin_clz(w & (~w + 1));
+}
+
+void bitmap_init(bitmap_t *b){
+  uint32_t w;
+  b->summary = 0;
+  for (w = 0; w < BITMAP_BITS / 32; w++) b->word[w] = 0;
+}
+
+void bitmap_set(bitmap_t *b, uint32_t i){
+  b->word[i >> 5] |= (1 << (i & 31));
+  b->summary |= (1 << (i >> 5));
+}
+
+void bitmap_clear(bitmap_t *b, uint32_t i){
+  b->word[i >> 5] &= ~(1 << (i & 31));
+  if (b->word[i >> 5] == 0) b->summary &= ~(1 << (i >> 5));
+}
+
+int bitmap_test(bitmap_t *b, uint32_t i){
+  return (b->word[i >> 5] >> (i & 31)) & 1;
+}
+
+uint32_t bitmap_first(bitmap_t *b){
+  if (b->summary == 0) return BITMAP_NONE;
+  uint32_t w = lowest_bit(b->summary);
+  return (w << 5) + lowest_bit(b->word[w]);
+}
+
+uint32_t bitmap_next(bitmap_t *b, uint32_t i){
+  if (i >= BITMAP_BITS) return BITMAP_NONE;
+  uint32_t w = i >> 5;
+  //the rest of i's own word first
+  uint32_t bits = b->word[w] & ~((1 << (i & 31)) - 1);
+  if (bits) return (w << 5) + lowest_bit(bits);
+  //then the first non-empty word above it
+  uint32_t words = b->summary & ~((2 << w) - 1);
+  if (words == 0) return BITMAP_NONE;
+  w = lowest_bit(words);
+  return (w << 5) + lowest_bit(b->word[w]);
+}
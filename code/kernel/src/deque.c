@@ -0,0 +1,59 @@
+/**
+ * @file   deque.c
+ *
+ * @brief  Implementation of the work-stealing deque. The owner only races
+ *         thieves for the last entry, both sides settle it with a
+ *         compare-and-swap on top.
+ *
+ * @date   10.15.2026
+ * @author yanyingz
+ */
+
+#include <kstdint.h>
+#include <arm.h>
+#include <deque.h>
+
+void deque_init(deque_t *d){
+  d->top = 0;
+  d->bottom = 0;
+}
+
+int deque_push(deque_t *d, deque_entry_t *entry){
+  uint32_t b = d->bottom;
+  uint32_t t = d->top;
+  if (b - t >= DEQUE_SIZE) return -1;
+  d->entry[b & (DEQUE_SIZE - 1)] = *entry;
+  //thieves must see the entry before the new bottom
+  memory_barrier();
+  d->bottom = b + 1;
+  return 0;
+}
+
+int deque_pop(deque_t *d, deque_entry_t *entry){
+  uint32_t b = d->bottom - 1;
+  d->bottom = b;
+  //claim the slot before looking at top, or a thief could take it as well
+  memory_barrier();
+  uint32_t t = d->top;
+  if ((int32_t)(b - t) < 0){
+    d->bottom = b + 1;
+    return -1;
+  }
+  *entry = d->entry[b & (DEQUE_SIZE - 1)];
+  if (b != t) return 0;
+
+  //last entry, race the thieves for it
+  int won = compare_and_swap(&d->top, t, t + 1);
+  d->bottom = t + 1;
+  return won ? 0 : -1;
+}
+
+int deque_steal(deque_t *d, deque_entry_t *entry){
+  uint32_t t = d->top;
+  memory_barrier();
+  uint32_t b = d->bottom;
+  if ((int32_t)(b - t) <= 0) return -1;
+  //read before claiming, the owner cannot reuse the slot until top moves
+  *entry = d->entry[t & (DEQUE_SIZE - 1)];
+  return compare_and_swap(&d->top, t, t + 1) ? 0 : -1;
+}
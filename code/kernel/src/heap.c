@@ -0,0 +1,114 @@
+/**
+ * @file   heap.c
+ *
+ * @brief  Implementation of the binary min-heap used by the scheduler
+ *
+ * @date   10.15.2026
+ * @author yanyingz
+ */
+
+#include <kstdint.h>
+#include <heap.h>
+
+/**@brief true if entry a should sit above entry b*/
+static int heap_less(heap_t *h, uint32_t a, uint32_t b){
+  if (h->key[a] != h->key[b]) return h->key[a] < h->key[b];
+  return h->id[a] < h->id[b];
+}
+
+/**@brief swap two entries and keep the position index up to date*/
+static void heap_swap(heap_t *h, uint32_t a, uint32_t b){
+  uint32_t key = h->key[a];
+  uint32_t id = h->id[a];
+  h->key[a] = h->key[b];
+  h->id[a] = h->id[b];
+  h->key[b] = key;
+  h->id[b] = id;
+  h->pos[h->id[a]] = a;
+  h->pos[h->id[b]] = b;
+}
+
+/**@brief move an entry up until its parent is smaller*/
+static void heap_sift_up(heap_t *h, uint32_t i){
+  while (i > 0 && heap_less(h, i, (i - 1) / 2)){
+    heap_swap(h, i, (i - 1) / 2);
+    i = (i - 1) / 2;
+  }
+}
+
+/**@brief move an entry down until both children are larger*/
+static void heap_sift_down(heap_t *h, uint32_t i){
+  while (1){
+    uint32_t min = i;
+    uint32_t l = 2 * i + 1;
+    uint32_t r = 2 * i + 2;
+    if (l < h->size && heap_less(h, l, min)) min = l;
+    if (r < h->size && heap_less(h, r, min)) min = r;
+    if (min == i) return;
+    heap_swap(h, i, min);
+    i = min;
+  }
+}
+
+/**@brief smallest accepted entry below and at i if it is smaller than best,
+ *        best otherwise; a subtree whose top is not smaller is skipped*/
+static uint32_t heap_match(heap_t *h, uint32_t i, heap_match_fn match,
+                           void *arg, uint32_t best){
+  if (i >= h->size || (best != HEAP_NONE && !heap_less(h, i, best))){
+    return best;
+  }
+  if (match(h->id[i], arg)) return i;
+  best = heap_match(h, 2 * i + 1, match, arg, best);
+  return heap_match(h, 2 * i + 2, match, arg, best);
+}
+
+void heap_init(heap_t *h){
+  int i;
+  for (i = 0; i < HEAP_SIZE; i++){
+    h->pos[i] = HEAP_NONE;
+  }
+  h->size = 0;
+}
+
+void heap_insert(heap_t *h, uint32_t id, uint32_t key){
+  if (h->pos[id] != HEAP_NONE) heap_remove(h, id);
+  uint32_t i = h->size++;
+  h->key[i] = key;
+  h->id[i] = id;
+  h->pos[id] = i;
+  heap_sift_up(h, i);
+}
+
+void heap_remove(heap_t *h, uint32_t id){
+  uint32_t i = h->pos[id];
+  if (i == HEAP_NONE) return;
+  uint32_t last = --h->size;
+  if (i != last){
+    heap_swap(h, i, last);
+    uint32_t moved = h->id[i];
+    heap_sift_up(h, i);
+    heap_sift_down(h, h->pos[moved]);
+  }
+  h->pos[id] = HEAP_NONE;
+}
+
+int heap_contains(heap_t *h, uint32_t id){
+  return h->pos[id] != HEAP_NONE;
+}
+
+int heap_empty(heap_t *h){
+  return h->size == 0;
+}
+
+uint32_t heap_min_id(heap_t *h){
+  return h->id[0];
+}
+
+uint32_t heap_min_key(heap_t *h){
+  return h->key[0];
+}
+
+uint32_t heap_min_match(heap_t *h, heap_match_fn match, void *arg){
+  uint32_t i = heap_match(h, 0, match, arg, HEAP_NONE);
+  return (i == HEAP_NONE) ? HEAP_NONE : h->id[i];
+}
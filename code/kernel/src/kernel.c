@@ -13,88 +13,142 @@
 #include <arm.h>
 #include <uart.h>
 #include <timer.h>
+#include <systimer.h>
+#include <mmu.h>
+#include <smp.h>
 #include <supervisor.h>
 #include <swi_num.h>
 #include <syscalls.h>
+#include <user_page.h>
+#include <trace.h>
+#include <profile.h>
 /**
  * @brief The kernel entry point
  */
 void kernel_main(void) {
 
   uart_init();
+  pmu_init();
+  vfp_init();
   install_interrupt_table();
+  // the vector table is written before the caches are on
+  mmu_init(&user_page);
+  write_tpidruro((uint32_t)&((user_page_t *)USER_PAGE_ADDR)->core[0]);
+  smp_irq_init(0);
+#ifdef SMP
+  smp_boot();
+#endif
   while (1){
     enter_user_mode();
   }
 }
 
 
+/**
+ * @brief Entry point of cores 1-3 after boot.S gave them stacks. They wait
+ *        for scheduler_start() and then run the tasks partitioned onto them.
+ */
+void kernel_secondary_main(void) {
+  uint32_t core = get_core_id();
+  pmu_init();
+  vfp_init();
+  mmu_start();
+  write_tpidruro((uint32_t)&((user_page_t *)USER_PAGE_ADDR)->core[core]);
+  smp_irq_init(core);
+  scheduler_start_secondary();
+}
+
+
+/**
+ * @brief Acknowledges the pending IRQ and runs the scheduler
+ * @param sp is a pointer that points to the current context stack
+ * @return the pointer to the new context to resume
+ */
+static uint32_t *irq_dispatch(uint32_t *sp) {
+  uint32_t core = get_core_id();
+#ifdef PROFILE
+  // a sample on its own resumes the interrupted code without a reschedule
+  if (profile_irq(core, sp) && !smp_irq_other_pending(core)) return sp;
+#endif
+  // another core changed our pools, the dispatch below picks that up
+  if (smp_ipi_is_pending(core)) {
+    smp_ipi_clear_pending(core);
+  }
+  if (core != 0) {
+    if (smp_timer_is_pending(core)) {
+      smp_timer_clear_pending();
+      return call_scheduler(sp);
+    }
+    return dispatch(sp);
+  }
+#ifdef TICKLESS
+  if (systimer_is_pending()) {
+    systimer_clear_pending();
+    return call_scheduler(sp);
+  }
+#else
+  if (timer_is_pending()) {
+    timer_clear_pending();
+    return call_scheduler(sp);
+  }
+#endif
+  // device irqs may have queued aperiodic jobs, reschedule without a tick
+  return dispatch(sp);
+}
+
 /**
  * @brief Handler called when an IRQ occurs
  * @param sp is a pointer that points to the current context stack
  * @return the pointer to the new context to resume
  */
 uint32_t *irq_c_handler(uint32_t *sp) {
-  timer_clear_pending();
-  return call_scheduler(sp);
+  trace(TRACE_IRQ_ENTER, 0);
+  sp = irq_dispatch(sp);
+  trace(TRACE_IRQ_EXIT, 0);
+  return sp;
 }
 
 
 /**
- * @brief Handles the given swi_num
- *
- * @param swi_num the swi number passed in from swi_asm_handler
- * @param args pointer to arguments array, set up by the swi_asm_handler
- *
- * @return the return result of the syscall
+ * @brief Syscalls by SWI number, called by swi_asm_handler with the caller's
+ *        r0-r3 as the first four arguments and r4 as the fifth. Numbers
+ *        without an entry fail with -1.
  */
-void *swi_c_handler(int swi_num, int *args, int more) {
-  switch(swi_num){
-    case (SWI_SBRK):
-	return syscall_sbrk(args[0]);
-    case (SWI_WRITE):
-	return (void *)syscall_write(args[0], (char*)args[1], args[2]);
-    case (SWI_READ):
-	return (void *)syscall_read(args[0], (char*)args[1], args[2]);
-    case (SWI_EXIT):
-	syscall_exit(args[0]);
-	return (void*)-1;
-    case (SWI_CLOSE):
-	return (void *)syscall_close(args[0]);
-    case (SWI_FSTAT):
-	return (void *)syscall_fstat(args[0], (void*)args[1]);
-    case (SWI_ISATTY):
-	return (void *)syscall_isatty(args[0]);
-    case (SWI_LSEEK):
-	return (void *)syscall_lseek(args[0], args[1], args[2]);
-    case (SWI_ADC_START):
-    case (SWI_ADC_STOP):
-    case (SWI_THR_INIT):
-	return (void *)thread_init((thread_fn)args[0], (uint32_t *)args[1]);
-    case (SWI_THR_CREATE):
-	return (void *)thread_create((thread_fn)args[0], (uint32_t *)args[1],
-		args[2], args[3], more);
-    case (SWI_MUT_INIT):
-	return (void*)mutex_init((mutex_t *)args[0], args[1]);
-    case (SWI_MUT_LOK):
-	mutex_lock((mutex_t *)args[0]);
-	return (void *)-1;
-    case (SWI_MUT_ULK):
-	mutex_unlock((mutex_t *)args[0]);
-	return (void *)-1;
-    case (SWI_WAIT):
-	wait_until_next_period();
-	return (void *)-1;
-    case (SWI_TIME):
-	return (void*)get_time();
-    case (SWI_SCHD_START):
-	return (void *)scheduler_start();
-    case (SWI_PRIORITY):
-	return (void*)get_priority();
-    case (SWI_SPIN_WAIT):
-	spin_wait(args[0]);
-	return (void *)-1;
-    default: 
-	return (void *)-1;
-  }
-}
+swi_fn const swi_table[SWI_NUM] = {
+  [SWI_SBRK] = (swi_fn)syscall_sbrk,
+  [SWI_WRITE] = (swi_fn)syscall_write,
+  [SWI_CLOSE] = (swi_fn)syscall_close,
+  [SWI_FSTAT] = (swi_fn)syscall_fstat,
+  [SWI_ISATTY] = (swi_fn)syscall_isatty,
+  [SWI_LSEEK] = (swi_fn)syscall_lseek,
+  [SWI_READ] = (swi_fn)syscall_read,
+  [SWI_EXIT] = (swi_fn)syscall_exit,
+  // no ADC sampling in this kernel, SWI_ADC_START and SWI_ADC_STOP fail
+  [SWI_THR_INIT] = (swi_fn)thread_init,
+  [SWI_THR_CREATE] = (swi_fn)thread_create,
+  [SWI_MUT_INIT] = (swi_fn)mutex_init,
+  [SWI_MUT_LOK] = (swi_fn)mutex_lock,
+  [SWI_MUT_ULK] = (swi_fn)mutex_unlock,
+  [SWI_WAIT] = (swi_fn)wait_until_next_period,
+  [SWI_TIME] = (swi_fn)get_time,
+  [SWI_SCHD_START] = (swi_fn)scheduler_start,
+  [SWI_PRIORITY] = (swi_fn)get_priority,
+  [SWI_SPIN_WAIT] = (swi_fn)spin_wait,
+  [SWI_SCHD_POLICY] = (swi_fn)scheduler_set_policy,
+  [SWI_SCHD_ADMIT] = (swi_fn)scheduler_admit,
+  [SWI_THR_EXIT] = (swi_fn)thread_exit,
+  [SWI_SRV_CREATE] = (swi_fn)server_create,
+  [SWI_APER_SUBMIT] = (swi_fn)aperiodic_submit,
+  [SWI_APER_NEXT] = (swi_fn)aperiodic_next,
+  [SWI_THR_OVERRUN] = (swi_fn)thread_set_overrun,
+  [SWI_THR_STATS] = (swi_fn)thread_stats,
+  [SWI_THR_HOLD] = (swi_fn)thread_hold,
+  [SWI_WORK_SUBMIT] = (swi_fn)work_submit,
+  [SWI_WORK_TAKE] = (swi_fn)work_take,
+  [SWI_THR_KSTACK] = (swi_fn)thread_set_kstack,
+  [SWI_TRACE_DUMP] = (swi_fn)trace_dump,
+  [SWI_THR_HIST] = (swi_fn)thread_hist,
+  [SWI_HIST_DUMP] = (swi_fn)hist_dump,
+  [SWI_PROF_START] = (swi_fn)profile_start,
+  [SWI_PROF_DUMP] = (swi_fn)profile_dump,
+};
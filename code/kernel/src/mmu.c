@@ -0,0 +1,72 @@
+/**
+ * @file   mmu.c
+ *
+ * @brief  Implementation of the identity mapped translation table
+ *
+ * @date   10.15.2026
+ * @author yanyingz
+ */
+
+#include <mmu.h>
+#include <arm.h>
+#include <BCM2836.h>
+#include <kstdint.h>
+#include <user_page.h>
+
+/**@brief number of 1MB sections in the 4GB address space*/
+#define SECTION_NUM 4096
+/**@brief log2 of the section size*/
+#define SECTION_SHIFT 20
+/**@brief end of the peripherals, including the BCM2836 local ones*/
+#define MMIO_END_PHYSICAL 0x41000000
+/**@brief section descriptor type*/
+#define SECTION (0x2)
+/**@brief full access from every mode, AP[1:0] = 0b11*/
+#define AP_RW (0x3 << 10)
+/**@brief normal memory, write-back write-allocate, shareable*/
+#define NORMAL_WBWA ((0x1 << 12) | (1 << 3) | (1 << 2) | (1 << 16))
+/**@brief shareable device memory, never executed*/
+#define DEVICE ((1 << 2) | (1 << 4))
+/**@brief first level descriptor of a second level table of 4kB pages*/
+#define PAGE_TABLE (0x1)
+/**@brief second level descriptor of a 4kB page, never executed*/
+#define SMALL_PAGE (0x2 | 0x1)
+/**@brief kernel read/write, user read-only, AP[2:0] = 0b010*/
+#define AP_USER_RO (0x2 << 4)
+/**@brief normal memory, write-back write-allocate, shareable, in a 4kB page
+ *        descriptor*/
+#define PAGE_NORMAL_WBWA ((1 << 10) | (0x1 << 6) | (1 << 3) | (1 << 2))
+/**@brief entries of a second level table*/
+#define PAGE_NUM 256
+
+/**@brief first level translation table, TTBR0 needs 16kB alignment*/
+uint32_t mmu_table[SECTION_NUM] __attribute__((aligned(16384)));
+/**@brief second level table of the section holding USER_PAGE_ADDR*/
+uint32_t user_page_table[PAGE_NUM] __attribute__((aligned(1024)));
+
+void mmu_init(void *user_page) {
+  uint32_t i;
+  for (i = 0; i < SECTION_NUM; i++) {
+    uint32_t base = i << SECTION_SHIFT;
+    if (base < MMIO_BASE_PHYSICAL) {
+      mmu_table[i] = base | SECTION | AP_RW | NORMAL_WBWA;
+    } else if (base < MMIO_END_PHYSICAL) {
+      mmu_table[i] = base | SECTION | AP_RW | DEVICE;
+    } else {
+      //unmapped, faults
+      mmu_table[i] = 0;
+    }
+  }
+  //the rest of the section faults
+  for (i = 0; i < PAGE_NUM; i++) user_page_table[i] = 0;
+  user_page_table[0] = (uint32_t)user_page | SMALL_PAGE | AP_USER_RO |
+                       PAGE_NORMAL_WBWA;
+  mmu_table[USER_PAGE_ADDR >> SECTION_SHIFT] = (uint32_t)user_page_table |
+                                               PAGE_TABLE;
+  mmu_start();
+}
+
+
+void mmu_start(void) {
+  mmu_enable(mmu_table);
+}
@@ -0,0 +1,140 @@
+/**
+ * @file   profile.c
+ *
+ * @brief  Sample tables of the profiler. Each core only writes its own
+ *         table from its IRQ handler, so counting takes no lock. A table
+ *         is an open addressed hash on (pc, thread, priority); a sample
+ *         that finds no slot within a few probes is only counted as
+ *         dropped.
+ *
+ * @date   10.16.2026
+ * @author yanyingz
+ */
+
+#include <kstdint.h>
+#include <arm.h>
+#include <smp.h>
+#include <printk.h>
+#include <syscalls.h>
+#include <profile.h>
+
+#ifdef PROFILE
+
+/**@brief slots tried before a sample is dropped*/
+#define PROFILE_PROBES	8
+/**@brief cycles a core may still spend in profile_record after sampling
+ *        was paused*/
+#define PROFILE_SETTLE	1000
+
+profile_slot_t profile_table[CORE_NUM][PROFILE_SLOTS];
+uint32_t profile_dropped[CORE_NUM];
+/**@brief cycles between samples every core should use, 0 for none*/
+volatile uint32_t profile_interval;
+/**@brief interval each core's PMU is programmed with*/
+uint32_t profile_armed[CORE_NUM];
+/**@brief set while a dump reads the tables, also keeps out a second dump*/
+volatile uint32_t profile_paused;
+
+/**@brief bring the calling core's PMU in line with profile_interval*/
+static void profile_sync(uint32_t core){
+  uint32_t interval = profile_interval;
+  if (profile_armed[core] == interval) return;
+  profile_armed[core] = interval;
+  if (interval != 0){
+    pmu_sample_set(interval);
+  }else{
+    pmu_sample_stop();
+  }
+}
+
+int profile_irq(uint32_t core, uint32_t *sp){
+  profile_sync(core);
+  if (!pmu_sample_pending()) return 0;
+  //rearming first keeps the sampling period free of our own cost
+  pmu_sample_set(profile_armed[core]);
+  profile_sample(sp);
+  return 1;
+}
+
+void profile_record(uint32_t pc, uint32_t tid, uint32_t priority,
+                    uint32_t kernel){
+  if (profile_paused) return;
+  uint32_t core = get_core_id();
+  profile_slot_t *table = profile_table[core];
+  tid &= 0xffff;
+  //fibonacci hashing, the top bits of the product are the best mixed
+  uint32_t h = (((pc >> 2) ^ (tid << 16)) * 2654435761u) >> 16;
+  uint32_t i;
+  for (i = 0; i < PROFILE_PROBES; i++){
+    profile_slot_t *s = &table[(h + i) & (PROFILE_SLOTS - 1)];
+    if (s->count == 0){
+      s->pc = pc;
+      s->tid = tid;
+      s->priority = priority;
+      s->kernel = kernel;
+      s->count = 1;
+      return;
+    }
+    if (s->pc == pc && s->tid == tid && s->priority == priority){
+      s->count++;
+      return;
+    }
+  }
+  profile_dropped[core]++;
+}
+
+int profile_start(unsigned int interval){
+  if (interval != 0 && interval < PROFILE_MIN_CYCLES) return -1;
+  profile_interval = interval;
+  memory_barrier();
+  uint32_t me = get_core_id();
+  uint32_t core;
+  disable_interrupts();
+  profile_sync(me);
+  enable_interrupts();
+  //the other cores pick it up on their next irq, make that now
+  for (core = 0; core < CORE_NUM; core++){
+    if (core != me) smp_ipi_send(core);
+  }
+  return 0;
+}
+
+int profile_dump(void){
+  if (!compare_and_swap(&profile_paused, 0, 1)) return -1;
+  budget_pause();
+  delay_cycles(PROFILE_SETTLE);
+
+  int total = 0;
+  uint32_t dropped = 0;
+  uint32_t core, i;
+  for (core = 0; core < CORE_NUM; core++){
+    for (i = 0; i < PROFILE_SLOTS; i++){
+      profile_slot_t *s = &profile_table[core][i];
+      if (s->count == 0) continue;
+      printk("prof %u %u %u %c %x %u\n", core, s->tid, s->priority,
+             s->kernel ? 'k' : 'u', s->pc, s->count);
+      total += s->count;
+      s->count = 0;
+    }
+    dropped += profile_dropped[core];
+    profile_dropped[core] = 0;
+  }
+  printk("prof end %u %u\n", total, dropped);
+
+  memory_barrier();
+  profile_paused = 0;
+  budget_resume();
+  return total;
+}
+
+#else
+
+int profile_start(unsigned int interval){
+  return -1;
+}
+
+int profile_dump(void){
+  return -1;
+}
+
+#endif
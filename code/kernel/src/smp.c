@@ -0,0 +1,99 @@
+/**
+ * @file   smp.c
+ *
+ * @brief  Implementation of routines for the BCM2836 local peripherals
+ *
+ * @date   10.15.2026
+ * @author yanyingz
+ */
+
+#include <smp.h>
+#include <arm.h>
+#include <kstdint.h>
+
+/**@brief define the base register for the local peripherals*/
+#define LOCAL_BASE 0x40000000
+/**@brief define the timer irq control register of a core*/
+#define TIMER_IRQ_CNTL(n) (volatile uint32_t *) (LOCAL_BASE + 0x40 + 4 * (n))
+/**@brief define the mailbox irq control register of a core*/
+#define MBOX_IRQ_CNTL(n) (volatile uint32_t *) (LOCAL_BASE + 0x50 + 4 * (n))
+/**@brief define the register that routes a core's PMU irq to its irq line*/
+#define PMU_IRQ_SET (volatile uint32_t *) (LOCAL_BASE + 0x10)
+/**@brief define the irq source register of a core*/
+#define IRQ_SOURCE(n) (volatile uint32_t *) (LOCAL_BASE + 0x60 + 4 * (n))
+/**@brief define the write-set register of mailbox m of a core*/
+#define MBOX_SET(n, m) (volatile uint32_t *) (LOCAL_BASE + 0x80 + 16 * (n) + 4 * (m))
+/**@brief define the read/write-clear register of mailbox m of a core*/
+#define MBOX_CLR(n, m) (volatile uint32_t *) (LOCAL_BASE + 0xc0 + 16 * (n) + 4 * (m))
+/**@brief virtual generic timer bit in the timer control and irq source*/
+#define CNTV_IRQ (1 << 3)
+/**@brief mailbox 0 bit in the mailbox control register*/
+#define MBOX0_IRQ (1 << 0)
+/**@brief mailbox 0 bit in the irq source register*/
+#define MBOX0_SOURCE (1 << 4)
+/**@brief PMU bit in the irq source register*/
+#define PMU_SOURCE (1 << 9)
+/**@brief mailbox the firmware parks cores 1-3 on*/
+#define BOOT_MBOX 3
+/**@brief mailbox used for reschedule requests*/
+#define IPI_MBOX 0
+
+extern void _start_secondary(void);
+
+/**@brief generic timer ticks between two scheduler ticks*/
+uint32_t gtimer_interval;
+
+void smp_boot(void) {
+  uint32_t core;
+  for (core = 1; core < CORE_NUM; core++) {
+    *MBOX_SET(core, BOOT_MBOX) = (uint32_t)_start_secondary;
+  }
+  send_event();
+}
+
+
+void smp_irq_init(uint32_t core) {
+  *MBOX_CLR(core, IPI_MBOX) = 0xffffffff;
+  *MBOX_IRQ_CNTL(core) |= MBOX0_IRQ;
+#ifdef PROFILE
+  //write-one-to-set, the PMU only raises it once the profiler runs
+  *PMU_IRQ_SET = 1 << core;
+#endif
+}
+
+
+void smp_timer_start(uint32_t core, uint32_t freq) {
+  gtimer_interval = gtimer_freq() / freq;
+  *TIMER_IRQ_CNTL(core) |= CNTV_IRQ;
+  gtimer_set(gtimer_interval);
+}
+
+
+int smp_timer_is_pending(uint32_t core) {
+  return ((*IRQ_SOURCE(core) & CNTV_IRQ) != 0);
+}
+
+
+void smp_timer_clear_pending(void) {
+  gtimer_set(gtimer_interval);
+}
+
+
+void smp_ipi_send(uint32_t core) {
+  *MBOX_SET(core, IPI_MBOX) = 1;
+}
+
+
+int smp_ipi_is_pending(uint32_t core) {
+  return ((*IRQ_SOURCE(core) & MBOX0_SOURCE) != 0);
+}
+
+
+void smp_ipi_clear_pending(uint32_t core) {
+  *MBOX_CLR(core, IPI_MBOX) = 0xffffffff;
+}
+
+
+int smp_irq_other_pending(uint32_t core) {
+  return ((*IRQ_SOURCE(core) & ~PMU_SOURCE) != 0);
+}
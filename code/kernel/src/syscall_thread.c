@@ -5,6 +5,7 @@
  */
 
 #include <kstdint.h>
+#include <BCM2836.h>
 #include "mutex.h"
 #include <printk.h>
 #include <uart.h>
@@ -14,22 +15,46 @@
 #include <supervisor.h>
 #include <swi_num.h>
 #include <syscalls.h>
+#include <heap.h>
+#include <bitmap.h>
+#include <deque.h>
+#include <systimer.h>
+#include <smp.h>
+#include <trace.h>
+#include <profile.h>
+#include <psr.h>
 
-/**@brief total thread numbers: 31 tasks + 1 idle function*/
-#define THREAD_NUM	32
-/**@brief stack size for one task*/
-#define TCB_STACK_SIZE	1024
-/**@brief save context for one task*/
-#define TCB_REG_NUM	20
+/**@brief no thread, ends a mutex wait list*/
+#define THREAD_NONE	0xffffffff
+/**@brief number of priority levels, 0 is the highest; thread ids and
+ *        levels must fit the heaps and bitmaps*/
+#define PRIO_NUM	(THREAD_PRIO_MAX + 1)
+/**@brief cache line size of the Cortex-A7*/
+#define CACHE_LINE	64
+/**@brief words of the context an interrupt or a yielding syscall leaves on
+ *        the kernel stack of a thread*/
+#define FRAME_WORDS	20
 /**@brief define runnable status*/
 #define RUNNABLE	1
 /**@brief define waiting status*/
 #define WAITING		0
 /**@brief define running status*/
 #define RUNNING		2
+/**@brief define blocked status, parked on a mutex wait queue*/
+#define BLOCKED		3
+/**@brief define exited status, the tcb is freed at the end of the period*/
+#define EXITED		4
+/**@brief define suspended status, a server with no aperiodic job queued*/
+#define SUSPENDED	5
+/**@brief timing state of a thread's current job: not timed, released and
+ *        waiting for its first dispatch, or dispatched*/
+#define JOB_UNTIMED	0
+#define JOB_RELEASED	1
+#define JOB_STARTED	2
 /**@brief define the index for spsr in svc mode*/
 #define SPSR_SVC	0
-/**@brief define the index for sp in svc mode*/
+/**@brief define the index for sp in svc mode, only informative: the svc
+ *        sp of a saved thread is just above its frame*/
 #define SP_SVC		1
 /**@brief define the index for lr in svc mode*/
 #define LR_SVC		2
@@ -37,275 +62,2092 @@
 #define SP_USER		3
 /**@brief define the index for lr in user mode*/
 #define LR_USER		4
-/**@brief define the index for lr in irq mode*/
+/**@brief define the index for the pc the thread resumes at*/
 #define LR_IRQ		18
-/**@brief define the index for spsr in irq mode*/
+/**@brief define the index for the cpsr the thread resumes with*/
 #define SPSR_IRQ	19
+/**@brief maximum number of registered mutexes, slot 0 is never used*/
+#define MUTEX_NUM	256
+/**@brief end of a mutex list, also the id of an unregistered mutex*/
+#define MUTEX_NONE	0
+/**@brief mutexes a thread can declare critical sections on*/
+#define HOLD_DECL_NUM	8
+/**@brief priority reserved for the idle task*/
+#define IDLE_PRIO	THREAD_PRIO_MAX
+/**@brief core of a task the partitioner has not placed yet*/
+#define CORE_NONE	0xffffffff
+/**@brief run queue a task is linked into: none, the ready queue, or the
+ *        background queue of demoted tasks*/
+#define QUEUE_NONE	0
+#define QUEUE_READY	1
+#define QUEUE_BACKGROUND	2
+/**@brief microseconds per scheduler millisecond*/
+#define US_PER_MS	1000
+/**@brief assumed cost of one scheduler pass until one has been measured*/
+#define SCHED_COST_US	10
+/**@brief deadlines the EDF demand test checks one by one, it runs with
+ *        IRQs off, also while the scheduler runs*/
+#define EDF_MAX_POINTS	1024
+/**@brief pending budget replenishments of the sporadic server*/
+#define SERVER_REPL_NUM	8
+/**@brief aperiodic jobs that can be queued for the server, power of two*/
+#define JOB_QUEUE_SIZE	16
+/**@brief longest the tickless scheduler sleeps, keeps the 32-bit
+ *        microsecond counter from wrapping between two events, and the
+ *        cycle counter between two traced IRQs on core 0*/
+#define TICKLESS_MAX_SLEEP	1000
+#if TICKLESS_MAX_SLEEP * 1000ULL * CPU_MHZ >= 0x100000000ULL
+#error "trace2json.py can not unwrap cycle stamps further apart than 2^32"
+#endif
+/**@brief user stack words of the idle tasks of cores 1-3, they run
+ *        stolen work*/
+#define IDLE_STACK_WORDS 1024
+/**@brief kernel stack of a thread unless thread_set_kstack() said otherwise*/
+#define KSTACK_DEFAULT	4096
+/**@brief smallest kernel stack, the deepest syscall fits in it*/
+#define KSTACK_MIN	1024
+/**@brief largest kernel stack*/
+#define KSTACK_MAX	65536
 
 
+/** @brief longest critical section a thread declared on one mutex */
+typedef struct hold_decl {
+  //mutex id, MUTEX_NONE for a free slot
+  uint32_t mutex;
+  uint32_t us;
+} hold_decl_t;
+
+/** @brief per-thread state the tick never touches, only context switches,
+ *         mutexes and admission. It is allocated
+ *         together with the thread's kernel stack, which grows down from
+ *         just below it */
+typedef struct thread_ctx {
+  //saved context on the kernel stack while the thread is switched out,
+  //in order: spsr_svc, sp_svc, lr_svc, sp_user, lr_user, r0-r12, pc, cpsr
+  uint32_t *frame;
+  //system timer at the release of the current job and its JOB_* state,
+  //next to frame, which a switch reads anyway
+  uint32_t release_us;
+  uint32_t job_state;
+  //bytes of kernel stack below this record
+  uint32_t kstack_size;
+  //next unused context, while on ctx_free_list
+  struct thread_ctx *free_next;
+  //mutex this task is blocked trying to lock
+  mutex_t *want;
+  //next task waiting on the same mutex, in priority order
+  uint32_t wait_next;
+  //first of the mutexes this task holds
+  uint32_t held;
+  //core the admission tests count the task on, CORE_NONE while unplaced
+  uint32_t place;
+  //neighbours in thread_list
+  struct TCB *list_prev;
+  struct TCB *list_next;
+  //what happens when a job runs past its computation time
+  uint32_t overrun_policy;
+  aperiodic_fn overrun_handler;
+  uint32_t overruns;
+  uint32_t misses;
+  uint32_t max_lateness;
+  thread_hist_t hist;
+  //critical sections declared with thread_hold(), the admission tests
+  //bound blocking with them
+  hold_decl_t holds[HOLD_DECL_NUM];
+  //system timer when the thread was last switched out holding a mutex,
+  //and the time it spent switched out so, which is not charged to the
+  //critical sections it holds
+  uint32_t hold_out;
+  uint32_t hold_preempted;
+  //critical sections that ran longer than declared
+  uint32_t long_holds;
+  //set while a dump syscall writes over UART, the time it runs then is
+  //not charged to its budget
+  uint32_t uncharged;
+  //d0-d31 and the FPSCR while another thread has the FPU
+  uint32_t vfp[VFP_REG_NUM];
+} thread_ctx_t;
+
+/** @brief what the scheduler reads and writes on every pass, 16 words so
+ *         each tcb in tcb_pool fills exactly one cache line */
 typedef struct TCB{
-  
-  uint32_t tcb_stack[TCB_STACK_SIZE];
-  //In order: spsr_svc, sp_svc, lr_svc, sp_user, lr_user, r0-r12, lr_irq, spsr_irq
-  uint32_t tcb_regs[TCB_REG_NUM];
+  uint32_t status;
   uint32_t wakeup;
-  uint32_t execution;
+  //microseconds left of the current job's computation time, below 0 once
+  //the job overran
+  int32_t budget;
+  //microseconds the task has run
   uint32_t sleep;
   uint32_t computation;
   uint32_t period;
   uint32_t priority;
   uint32_t curr_priority;
-  uint32_t status;
-
+  //absolute deadline of the current job, orders the EDF ready queue
+  uint32_t deadline;
+  //absolute deadline of the oldest job not yet completed
+  uint32_t due;
+  //index in tcb_pool and key of the scheduler heaps
+  uint32_t id;
+  //core the task is partitioned onto
+  uint32_t core;
+  //run queue the task is in and its neighbours at its level there
+  uint32_t queue;
+  struct TCB *queue_prev;
+  struct TCB *queue_next;
+  thread_ctx_t *ctx;
 } tcb_t;
 
-/**@brief tcb pool*/
-tcb_t tcb_list[THREAD_NUM];
-/**@brief mutex pool*/
-uint32_t mutex_list[THREAD_NUM];
-/**@brief count the number of mutexes*/
-uint32_t mutex_index = 0;
-/**@brief pointer to the current running tcb block*/
-tcb_t* current_task;
-/**@brief using 32-bit integers to represent runnable pool and waiting pool*/
-uint32_t runnable_pool = 0;
-uint32_t waiting_pool = 0;
-uint32_t mutex_ceiling = 31;
+/** @brief kernel side record of a registered mutex */
+typedef struct mutex_rec {
+  mutex_t *mutex;
+  //links in the list of held mutexes that share this mutex's ceiling
+  uint16_t level_prev;
+  uint16_t level_next;
+  //links in the owner's list of held mutexes
+  uint16_t held_prev;
+  uint16_t held_next;
+  //system timer when the mutex was last locked, and the owner's
+  //hold_preempted then, to measure the critical section in cpu time
+  uint32_t lock_time;
+  uint32_t lock_preempted;
+} mutex_rec_t;
+
+/** @brief sporadic server: a thread whose budget C is used on aperiodic
+ *         jobs and each chunk of it is given back T after the server
+ *         became active to spend it, so it never demands more than a
+ *         periodic task with the same C and T */
+typedef struct server {
+  //the server thread, NULL when there is none
+  tcb_t *task;
+  uint32_t budget;
+  //time the server last became active, and budget used since then
+  uint32_t active;
+  uint32_t used;
+  //replenishments in time order, a ring starting at repl_head
+  uint32_t repl_time[SERVER_REPL_NUM];
+  uint32_t repl_amount[SERVER_REPL_NUM];
+  uint32_t repl_head;
+  uint32_t repl_count;
+} server_t;
 
-/**@brief system timer*/
-uint32_t time;
-/**@brief hard-coded utilization table for 0 to 32 tasks*/
-float utilization_list[33] = 
-		  {0.0, 1.0, 0.828427, 0.779763, 0.756828, 0.743492, 0.734772, 0.728627, 0.724062,
-		   0.720538, 0.717735, 0.715452, 0.713557, 0.711959, 0.710593, 0.709412, 0.708381,
-		   0.707472, 0.706666, 0.705946, 0.705298, 0.704713, 0.704182, 0.703698, 0.703254, 
-		   0.702846, 0.702469, 0.702121, 0.701798, 0.701497, 0.701217, 0.700955, 0.700709};
+/** @brief tasks queued by priority, first in first out within a level, so
+ *         the first task is found in constant time whatever their number */
+typedef struct run_queue {
+  //levels with at least one task
+  bitmap_t levels;
+  tcb_t *head[PRIO_NUM];
+  tcb_t *tail[PRIO_NUM];
+} run_queue_t;
 
-int is_runnable(uint32_t prio){
-  return ((runnable_pool >> prio) & 1);
+/** @brief scheduler state of one core, tasks are partitioned onto cores
+ *         and each core schedules its own */
+typedef struct core {
+  uint32_t id;
+  //pointer to the current running tcb block
+  tcb_t *current_task;
+  //runnable tasks at their effective priority, so a mutex holder runs at
+  //the priority it inherited
+  run_queue_t ready;
+  //tasks demoted below every other task for the rest of their period
+  run_queue_t background;
+  //waiting tasks ordered by wakeup time
+  heap_t release_queue;
+  //demoted tasks ordered by the end of their period
+  heap_t restore_queue;
+  //runnable tasks ordered by absolute deadline, mirrors the ready queue
+  //under SCHED_EDF
+  heap_t edf_queue;
+  //scheduler time in ms
+  uint32_t time;
+  //system timer when the running task was last charged
+  uint32_t run_stamp;
+  //task whose registers are loaded in the FPU, it is only enabled while
+  //this task runs
+  tcb_t *vfp_owner;
+#ifdef TICKLESS
+  //system timer counter value at the millisecond boundary `time`
+  uint32_t time_stamp;
+#endif
+} core_t;
+
+/**@brief scheduling state of every thread id, dense so a scheduler pass
+ *        touches one cache line per task*/
+tcb_t tcb_pool[THREAD_MAX] __attribute__((aligned(CACHE_LINE)));
+/**@brief live threads by id, including exited threads whose period has
+ *        not ended yet*/
+tcb_t *tcb_table[THREAD_MAX];
+/**@brief live threads in priority order, first come first within a
+ *        priority, walked by the admission tests*/
+tcb_t *thread_list = NULL;
+/**@brief ids not taken by a live thread*/
+bitmap_t free_ids;
+/**@brief contexts of threads that are gone, with their kernel stacks*/
+thread_ctx_t *ctx_free_list = NULL;
+/**@brief start of the part of the context arena never handed out*/
+char *ctx_brk = NULL;
+/**@brief kernel stack size of the threads created from now on*/
+uint32_t kstack_size = KSTACK_DEFAULT;
+/**@brief the clock and priority of every core, also mapped read-only at
+ *        USER_PAGE_ADDR*/
+user_page_t user_page __attribute__((aligned(4096)));
+/**@brief mutex registry, indexed by mutex id*/
+mutex_rec_t mutex_table[MUTEX_NUM];
+/**@brief next free mutex id*/
+uint32_t mutex_count = 1;
+/**@brief deadlines still to test in edf_admit(), by thread id*/
+heap_t edf_points;
+/**@brief ceilings of all held mutexes, the system ceiling is the first*/
+bitmap_t ceiling_map;
+/**@brief first held mutex at each ceiling*/
+uint16_t ceiling_head[PRIO_NUM];
+/**@brief scheduling policy, SCHED_RM or SCHED_EDF*/
+uint32_t sched_policy = SCHED_RM;
+/**@brief set once scheduler_start has admitted the task set*/
+uint32_t sched_started = 0;
+/**@brief set with IRQs masked by a syscall that gives up the cpu, makes
+ *        swi_asm_handler call dispatch() before returning, one per core*/
+uint32_t resched_pending[CORE_NUM];
+/**@brief serializes the cores' scheduler passes and syscalls*/
+volatile uint32_t sched_lock = 0;
+
+/**@brief the sporadic server*/
+server_t server = { .task = NULL };
+/**@brief aperiodic jobs waiting for the server, a ring starting at job_head*/
+aperiodic_job_t job_queue[JOB_QUEUE_SIZE];
+uint32_t job_head = 0;
+uint32_t job_count = 0;
+
+/**@brief scheduler state of each core*/
+core_t cores[CORE_NUM];
+/**@brief idle task of each core, all of them run the user's idle function*/
+tcb_t idle_list[CORE_NUM];
+thread_ctx_t idle_ctx[CORE_NUM];
+uint32_t idle_kstacks[CORE_NUM][KSTACK_DEFAULT / 4] __attribute__((aligned(8)));
+#if CORE_NUM > 1
+/**@brief user stacks of the idle tasks of cores 1-3*/
+uint32_t idle_stacks[CORE_NUM - 1][IDLE_STACK_WORDS];
+#endif
+/**@brief background work of each core, stolen by the others when idle*/
+deque_t work_deques[CORE_NUM];
+/**@brief longest scheduler pass seen so far, in cycles*/
+uint32_t sched_cost_max = 0;
+
+/**@brief scheduler state of the calling core*/
+core_t *this_core(void){
+#if CORE_NUM > 1
+  return &cores[get_core_id()];
+#else
+  return &cores[0];
+#endif
+}
+/**@brief scheduler state of the core a task runs on, every core has its
+ *        own idle task*/
+core_t *task_core(tcb_t *t){
+  return &cores[t->core];
+}
+/**@brief mask IRQs and, with several cores, take the scheduler lock*/
+void kernel_lock(void){
+  disable_interrupts();
+#if CORE_NUM > 1
+  spin_lock(&sched_lock);
+#endif
 }
-void set_run_pool(uint32_t prio){
-  runnable_pool |= (1 << prio);
+/**@brief undo kernel_lock*/
+void kernel_unlock(void){
+#if CORE_NUM > 1
+  spin_unlock(&sched_lock);
+#endif
+  enable_interrupts();
 }
-void clear_run_pool(uint32_t prio){
-  runnable_pool &= (~(1 << prio));
+/**@brief end a syscall that gives up the cpu: drop the scheduler lock,
+ *        IRQs stay masked until swi_asm_handler has called dispatch()*/
+void request_dispatch(void){
+  resched_pending[this_core()->id] = 1;
+#if CORE_NUM > 1
+  spin_unlock(&sched_lock);
+#endif
+}
+/**@brief make another core reschedule after its pools changed*/
+void kick(core_t *k){
+#if CORE_NUM > 1
+  if (sched_started && k != this_core()) smp_ipi_send(k->id);
+#endif
+}
+
+
+/**@brief link a task into a level of a run queue, at the back or, for a
+ *        task that was preempted and keeps its turn, at the front*/
+void run_queue_push(run_queue_t *q, tcb_t *t, uint32_t level, int front){
+  if (q->head[level] == NULL){
+    t->queue_prev = NULL;
+    t->queue_next = NULL;
+    q->head[level] = t;
+    q->tail[level] = t;
+    bitmap_set(&q->levels, level);
+  }else if (front){
+    t->queue_prev = NULL;
+    t->queue_next = q->head[level];
+    q->head[level]->queue_prev = t;
+    q->head[level] = t;
+  }else{
+    t->queue_prev = q->tail[level];
+    t->queue_next = NULL;
+    q->tail[level]->queue_next = t;
+    q->tail[level] = t;
+  }
+}
+/**@brief unlink a task from the level it was pushed at*/
+void run_queue_remove(run_queue_t *q, tcb_t *t, uint32_t level){
+  if (t->queue_prev != NULL){
+    t->queue_prev->queue_next = t->queue_next;
+  }else{
+    q->head[level] = t->queue_next;
+  }
+  if (t->queue_next != NULL){
+    t->queue_next->queue_prev = t->queue_prev;
+  }else{
+    q->tail[level] = t->queue_prev;
+  }
+  if (q->head[level] == NULL) bitmap_clear(&q->levels, level);
+}
+/**@brief first task at the highest level with one clz per bitmap level
+ * @return the task, or NULL if the queue is empty*/
+tcb_t *run_queue_first(run_queue_t *q){
+  uint32_t level = bitmap_first(&q->levels);
+  if (level == BITMAP_NONE) return NULL;
+  return q->head[level];
+}
+
+int is_runnable(tcb_t *t){
+  return t->queue == QUEUE_READY;
 }
-int is_waiting(uint32_t prio){
-  return ((waiting_pool >> prio) & 1);
+int is_background(tcb_t *t){
+  return t->queue == QUEUE_BACKGROUND;
 }
-void set_wait_pool(uint32_t prio){
-  waiting_pool |= (1 << prio);
+/**@brief a task demoted for the rest of its period, whichever queue it is in*/
+int is_demoted(tcb_t *t){
+  if (t->priority == IDLE_PRIO) return 0;
+  return heap_contains(&task_core(t)->restore_queue, t->id);
 }
-void clear_wait_pool(uint32_t prio){
-  waiting_pool &= (~(1 << prio));
+/**@brief queue a task at its effective priority, at the front of its level
+ *        if it was preempted*/
+void run_pool_insert(tcb_t *t, int front){
+  //the idle tasks run when both queues are empty
+  if (t->queue != QUEUE_NONE || t->priority == IDLE_PRIO) return;
+  core_t *k = task_core(t);
+  //a demoted task only runs from the background queue, unless it holds a
+  //mutex at a priority it inherited from the tasks waiting for it
+  if (t->curr_priority >= t->priority &&
+      heap_contains(&k->restore_queue, t->id)){
+    run_queue_push(&k->background, t, t->priority, front);
+    t->queue = QUEUE_BACKGROUND;
+    kick(k);
+    return;
+  }
+  run_queue_push(&k->ready, t, t->curr_priority, front);
+  t->queue = QUEUE_READY;
+  if (sched_policy == SCHED_EDF){
+    heap_insert(&k->edf_queue, t->id, t->deadline);
+  }
+  kick(k);
+}
+void set_run_pool(tcb_t *t){
+  run_pool_insert(t, 0);
+}
+/**@brief put the running task back in front of its level, it keeps its
+ *        turn among the tasks that share its priority*/
+void set_run_pool_head(tcb_t *t){
+  run_pool_insert(t, 1);
+}
+void clear_run_pool(tcb_t *t){
+  if (t->queue != QUEUE_READY) return;
+  core_t *k = task_core(t);
+  run_queue_remove(&k->ready, t, t->curr_priority);
+  t->queue = QUEUE_NONE;
+  heap_remove(&k->edf_queue, t->id);
+}
+int is_waiting(tcb_t *t){
+  if (t->priority == IDLE_PRIO) return 0;
+  return heap_contains(&task_core(t)->release_queue, t->id);
+}
+void set_wait_pool(tcb_t *t){
+  core_t *k = task_core(t);
+  heap_insert(&k->release_queue, t->id, t->wakeup);
+  kick(k);
+}
+void clear_wait_pool(tcb_t *t){
+  if (t->priority == IDLE_PRIO) return;
+  heap_remove(&task_core(t)->release_queue, t->id);
+}
+/**@brief demote a task below every other task until its period ends, it
+ *        stays in the background queue while it runs*/
+void set_background(tcb_t *t){
+  clear_run_pool(t);
+  core_t *k = task_core(t);
+  heap_insert(&k->restore_queue, t->id, t->wakeup + t->period);
+  run_pool_insert(t, 0);
+}
+/**@brief take a task out of the background queue, it stays demoted*/
+void leave_background(tcb_t *t){
+  if (t->queue != QUEUE_BACKGROUND) return;
+  run_queue_remove(&task_core(t)->background, t, t->priority);
+  t->queue = QUEUE_NONE;
+}
+void clear_background(tcb_t *t){
+  leave_background(t);
+  if (t->priority == IDLE_PRIO) return;
+  heap_remove(&task_core(t)->restore_queue, t->id);
+}
+/**@brief copy a core's clock and running priority into its record of
+ *        the user page, as seqlock writer; the sched lock or the kernel
+ *        lock keeps writers apart*/
+void user_page_publish(core_t *core){
+  user_core_page_t *p = &user_page.core[core->id];
+  p->seq++;
+  memory_barrier();
+  p->time = core->time;
+  p->stamp = systimer_read();
+  p->tickless = 0;
+#ifdef TICKLESS
+  //core 0 only counts milliseconds on events, readers add the rest
+  if (core->id == 0){
+    p->stamp = core->time_stamp;
+    p->tickless = 1;
+  }
+#endif
+  p->priority = core->current_task->curr_priority;
+  memory_barrier();
+  p->seq++;
+}
+
+/**@brief change the effective priority of a task, moving it to its new
+ *        level if it is in the ready queue*/
+void set_curr_priority(tcb_t *t, uint32_t curr){
+  //a demoted task moves between the queues as it inherits a priority and
+  //gives it back
+  if (is_runnable(t) || is_background(t)){
+    clear_run_pool(t);
+    leave_background(t);
+    t->curr_priority = curr;
+    set_run_pool(t);
+  }else{
+    t->curr_priority = curr;
+  }
+  trace(TRACE_PRIORITY, t->id | curr << 8);
+  if (t->core < CORE_NUM && cores[t->core].current_task == t){
+    user_page_publish(&cores[t->core]);
+  }
+}
+
+/**@brief take a context whose kernel stack is big enough from the free
+ *        list, or carve a new one out of the arena the linker reserves
+ *        after the kernel stacks
+ * @param size kernel stack bytes, a multiple of 8
+ * @return the context, or NULL when the arena is used up*/
+thread_ctx_t *ctx_alloc(uint32_t size){
+  extern char __tcb_low; // Defined by the linker
+  extern char __tcb_top; // Defined by the linker
+  thread_ctx_t **link = &ctx_free_list;
+  while (*link != NULL){
+    thread_ctx_t *ctx = *link;
+    if (ctx->kstack_size >= size){
+      *link = ctx->free_next;
+      return ctx;
+    }
+    link = &ctx->free_next;
+  }
+  //the stack sits below its context, keep both 8 byte aligned
+  uint32_t bytes = (size + sizeof(thread_ctx_t) + 7) & ~7;
+  if (ctx_brk == NULL) ctx_brk = &__tcb_low;
+  if (ctx_brk + bytes > &__tcb_top) return NULL;
+  thread_ctx_t *ctx = (thread_ctx_t *)(ctx_brk + size);
+  ctx->kstack_size = size;
+  ctx_brk += bytes;
+  return ctx;
+}
+
+/**@brief top of a context's kernel stack, the stack grows down from its
+ *        context*/
+uint32_t *ctx_kstack_top(thread_ctx_t *ctx){
+  return (uint32_t *)ctx;
+}
+
+/**@brief build the frame a new thread is first switched in from
+ * @param top top of the thread's kernel stack
+ * @param fn user mode entry point
+ * @param stack_start user stack
+ * @return the frame, just below top*/
+uint32_t *frame_init(uint32_t *top, thread_fn fn, uint32_t *stack_start){
+  uint32_t *frame = top - FRAME_WORDS;
+  int i;
+  for (i = 0; i < FRAME_WORDS; i++) frame[i] = 0;
+  frame[SP_USER] = (uint32_t)stack_start;
+  frame[SPSR_IRQ] = 0x10;
+  frame[SPSR_SVC] = 0x10;
+  frame[LR_IRQ] = (uint32_t) fn;
+  frame[LR_USER] = (uint32_t) fn;
+  frame[SP_SVC] = (uint32_t)top;
+  return frame;
+}
+
+/**@brief link a new thread into tcb_table and thread_list, behind the
+ *        threads that share its priority*/
+void thread_link(tcb_t *t){
+  tcb_table[t->id] = t;
+  bitmap_clear(&free_ids, t->id);
+  tcb_t *prev = NULL;
+  tcb_t *next = thread_list;
+  while (next != NULL && next->priority <= t->priority){
+    prev = next;
+    next = next->ctx->list_next;
+  }
+  t->ctx->list_prev = prev;
+  t->ctx->list_next = next;
+  if (prev != NULL){
+    prev->ctx->list_next = t;
+  }else{
+    thread_list = t;
+  }
+  if (next != NULL) next->ctx->list_prev = t;
+}
+
+/**@brief undo thread_link and give the tcb and its id back*/
+void thread_free(tcb_t *t){
+  if (t->ctx->list_prev != NULL){
+    t->ctx->list_prev->ctx->list_next = t->ctx->list_next;
+  }else{
+    thread_list = t->ctx->list_next;
+  }
+  if (t->ctx->list_next != NULL)
+    t->ctx->list_next->ctx->list_prev = t->ctx->list_prev;
+  tcb_table[t->id] = NULL;
+  bitmap_set(&free_ids, t->id);
+  if (t->core < CORE_NUM && cores[t->core].vfp_owner == t){
+    cores[t->core].vfp_owner = NULL;
+  }
+  t->ctx->free_next = ctx_free_list;
+  ctx_free_list = t->ctx;
 }
 
 int thread_init(thread_fn idle_fn, uint32_t *idle_stack_start) {
   if (idle_fn == NULL || idle_stack_start == NULL) return -1;
 
-  tcb_t *c_tcb = &tcb_list[31];
-  c_tcb->priority = 31;
-  c_tcb->curr_priority = 31;
-  c_tcb->computation = 100000;
-  c_tcb->period = 1;
-  c_tcb->status = RUNNABLE;
-  c_tcb->wakeup = 0;
-  c_tcb->execution = 0;
-  c_tcb->sleep = 0;
-  c_tcb->tcb_regs[SP_USER] = (uint32_t)idle_stack_start;
-  c_tcb->tcb_regs[SPSR_IRQ] = 0x10;
-  c_tcb->tcb_regs[SPSR_SVC] = 0x10;
-  c_tcb->tcb_regs[LR_IRQ] = (uint32_t) idle_fn;
-  c_tcb->tcb_regs[LR_USER] = (uint32_t) idle_fn;
-  c_tcb->tcb_regs[SP_SVC] = (uint32_t)(c_tcb->tcb_stack + 1023);
+  uint32_t k;
+  bitmap_init(&free_ids);
+  for (k = 0; k < THREAD_MAX; k++) bitmap_set(&free_ids, k);
+  for (k = 0; k < CORE_NUM; k++){
+    cores[k].id = k;
+    bitmap_init(&cores[k].ready.levels);
+    bitmap_init(&cores[k].background.levels);
+    heap_init(&cores[k].release_queue);
+    heap_init(&cores[k].restore_queue);
+    heap_init(&cores[k].edf_queue);
+  }
+
+  //every core idles in the user's idle function, cores 1-3 on our stacks
+  for (k = 0; k < CORE_NUM; k++){
+    deque_init(&work_deques[k]);
+    tcb_t *c_tcb = &idle_list[k];
+    c_tcb->ctx = &idle_ctx[k];
+    c_tcb->id = THREAD_NONE;
+    c_tcb->priority = IDLE_PRIO;
+    c_tcb->curr_priority = IDLE_PRIO;
+    c_tcb->computation = 100000;
+    c_tcb->period = 1;
+    c_tcb->status = RUNNABLE;
+    c_tcb->wakeup = 0;
+    c_tcb->budget = 0;
+    c_tcb->sleep = 0;
+    c_tcb->core = k;
+    c_tcb->queue = QUEUE_NONE;
+#if CORE_NUM > 1
+    if (k > 0) idle_stack_start = &idle_stacks[k - 1][IDLE_STACK_WORDS - 1];
+#endif
+    c_tcb->ctx->frame = frame_init(&idle_kstacks[k][KSTACK_DEFAULT / 4],
+                                   idle_fn, idle_stack_start);
+  }
   return 0;
 }
 
-int thread_create(thread_fn fn, uint32_t *stack_start,
-                  unsigned int prio, unsigned int C, unsigned int T) {
+int admit(uint32_t core, uint32_t from, uint32_t *wcrt);
+int partition(void);
+
+/**@brief first release of a thread created on core k while the scheduler
+ *        runs: right away under fixed priorities, whose analysis already
+ *        assumes the worst phasing, and after every current EDF job's
+ *        deadline, before which the old jobs may still need the core*/
+uint32_t online_release(core_t *k){
+  uint32_t release = k->time;
+  if (sched_policy == SCHED_EDF){
+    tcb_t *t;
+    for (t = thread_list; t != NULL; t = t->ctx->list_next){
+      if (t->core != k->id || t->status == WAITING ||
+          t->status == SUSPENDED) continue;
+      if (t->deadline > release) release = t->deadline;
+    }
+  }
+  return release;
+}
+
+/**@brief empty a histogram*/
+void hist_clear(hist_t *h){
+  int i;
+  for (i = 0; i < HIST_BUCKETS; i++) h->bucket[i] = 0;
+  h->max = 0;
+}
+
+/**@brief count a sample in the log2 bucket it falls into*/
+void hist_add(hist_t *h, uint32_t us){
+  uint32_t b = (us == 0) ? 0 : 32 - __builtin_clz(us);
+  if (b >= HIST_BUCKETS) b = HIST_BUCKETS - 1;
+  h->bucket[b]++;
+  if (us > h->max) h->max = us;
+}
+
+/**@brief thread_create() that hands back the new thread
+ * @return the new thread's id, or -1 on failure*/
+int thread_spawn(thread_fn fn, uint32_t *stack_start,
+                 unsigned int prio, unsigned int C, unsigned int T) {
   if (fn == NULL || stack_start == NULL) return -1;
+  if (prio >= IDLE_PRIO || T == 0) return -1;
 
-  tcb_t *c_tcb = &tcb_list[prio];
+  kernel_lock();
+  uint32_t id = bitmap_first(&free_ids);
+  thread_ctx_t *ctx = (id < THREAD_MAX) ? ctx_alloc(kstack_size) : NULL;
+  if (ctx == NULL){
+    kernel_unlock();
+    return -1;
+  }
+  tcb_t *c_tcb = &tcb_pool[id];
+  c_tcb->ctx = ctx;
+  c_tcb->id = id;
   c_tcb->priority = prio;
-  c_tcb->curr_priority = prio;
   c_tcb->computation = C;
   c_tcb->period = T;
+  c_tcb->ctx->place = CORE_NONE;
+  thread_link(c_tcb);
+  core_t *k = this_core();
+  if (sched_started){
+    //the first core whose tasks still pass admission with the new one
+    if (partition()){
+      thread_free(c_tcb);
+      kernel_unlock();
+      return -1;
+    }
+    k = &cores[c_tcb->ctx->place];
+  }
+
+  c_tcb->curr_priority = prio;
   c_tcb->status = RUNNABLE;
   c_tcb->wakeup = 0;
+  c_tcb->deadline = T;
   c_tcb->sleep = 0;
-  c_tcb->execution = 0;
-  c_tcb->tcb_regs[SP_USER] = (uint32_t)stack_start;
-  c_tcb->tcb_regs[SPSR_IRQ] = 0x10;
-  c_tcb->tcb_regs[SPSR_SVC] = 0x10;
-  c_tcb->tcb_regs[LR_IRQ] = (uint32_t) fn;
-  c_tcb->tcb_regs[LR_USER] = (uint32_t) fn;
-  c_tcb->tcb_regs[SP_SVC] = (uint32_t) (c_tcb->tcb_stack + 1023);
-  set_run_pool(prio);
-  //printk("c = %d, co = %d, t = %d, to = %d\n", C, c_tcb->computation, T, c_tcb->period);
+  c_tcb->budget = C * US_PER_MS;
+  c_tcb->ctx->want = NULL;
+  c_tcb->ctx->wait_next = THREAD_NONE;
+  c_tcb->ctx->held = MUTEX_NONE;
+  c_tcb->core = k->id;
+  c_tcb->ctx->place = k->id;
+  c_tcb->queue = QUEUE_NONE;
+  c_tcb->ctx->overrun_policy = OVERRUN_SUSPEND;
+  c_tcb->ctx->overrun_handler = NULL;
+  c_tcb->ctx->overruns = 0;
+  c_tcb->ctx->misses = 0;
+  c_tcb->ctx->max_lateness = 0;
+  c_tcb->ctx->hold_preempted = 0;
+  c_tcb->ctx->long_holds = 0;
+  c_tcb->ctx->uncharged = 0;
+  int i;
+  for (i = 0; i < HOLD_DECL_NUM; i++) c_tcb->ctx->holds[i].mutex = MUTEX_NONE;
+  c_tcb->ctx->job_state = JOB_UNTIMED;
+  hist_clear(&c_tcb->ctx->hist.response);
+  hist_clear(&c_tcb->ctx->hist.jitter);
+  //a new thread starts with zeroed FPU registers, not the last owner's
+  for (i = 0; i < VFP_REG_NUM; i++) c_tcb->ctx->vfp[i] = 0;
+  c_tcb->ctx->frame = frame_init(ctx_kstack_top(ctx), fn, stack_start);
+  c_tcb->due = T;
+  if (!sched_started){
+    set_run_pool(c_tcb);
+    kernel_unlock();
+    return id;
+  }
+  //wait in the release queue for a safe first release, the dispatch also
+  //reprograms the tickless alarm; IRQs stay masked until then
+  c_tcb->status = WAITING;
+  c_tcb->wakeup = online_release(k);
+  c_tcb->due = c_tcb->wakeup + T;
+  set_wait_pool(c_tcb);
+  request_dispatch();
+  return id;
+}
+
+int thread_create(thread_fn fn, uint32_t *stack_start,
+                  unsigned int prio, unsigned int C, unsigned int T) {
+  return (thread_spawn(fn, stack_start, prio, C, T) < 0) ? -1 : 0;
+}
+
+int thread_set_kstack(unsigned int size) {
+  if (size < KSTACK_MIN || size > KSTACK_MAX || (size & 7)) return -1;
+  kernel_lock();
+  kstack_size = size;
+  kernel_unlock();
+  return 0;
+}
+
+int thread_exit(void) {
+  kernel_lock();
+  tcb_t *current_task = this_core()->current_task;
+  //mutexes can not be handed over by a thread that is gone
+  if (current_task->priority == IDLE_PRIO || current_task->ctx->held != MUTEX_NONE ||
+      current_task == server.task){
+    kernel_unlock();
+    return -1;
+  }
+  current_task->status = EXITED;
+  request_dispatch();
   return 0;
 }
 
-uint32_t find_next_task(){
-  uint32_t prio = current_task->priority;
+/**@brief give the server every replenishment that has come due*/
+void server_replenish(void){
+  uint32_t time = task_core(server.task)->time;
+  while (server.repl_count > 0 && server.repl_time[server.repl_head] <= time){
+    server.budget += server.repl_amount[server.repl_head];
+    server.repl_head = (server.repl_head + 1) % SERVER_REPL_NUM;
+    server.repl_count--;
+  }
+  if (server.budget > server.task->computation * US_PER_MS){
+    server.budget = server.task->computation * US_PER_MS;
+  }
+}
+
+/**@brief the server stops using budget: what it used since it became
+ *        active comes back one server period after that*/
+void server_deactivate(void){
+  if (server.used == 0) return;
+  uint32_t at = server.active + server.task->period;
+  if (server.repl_count == SERVER_REPL_NUM){
+    //out of records, fold the latest one into this later one
+    uint32_t last = (server.repl_head + SERVER_REPL_NUM - 1) % SERVER_REPL_NUM;
+    server.repl_time[last] = at;
+    server.repl_amount[last] += server.used;
+  }else{
+    uint32_t tail = (server.repl_head + server.repl_count) % SERVER_REPL_NUM;
+    server.repl_time[tail] = at;
+    server.repl_amount[tail] = server.used;
+    server.repl_count++;
+  }
+  server.used = 0;
+}
+
+/**@brief make the server runnable if it has budget, otherwise let it
+ *        wait in the release queue for the next replenishment*/
+void server_activate(void){
+  tcb_t *t = server.task;
+  uint32_t time = task_core(t)->time;
+  server_replenish();
+  if (server.budget == 0){
+    t->status = WAITING;
+    t->wakeup = server.repl_time[server.repl_head];
+    set_wait_pool(t);
+    return;
+  }
+  server.active = time;
+  server.used = 0;
+  t->status = RUNNABLE;
+  t->deadline = time + t->period;
+  set_run_pool(t);
+}
+
+/**@brief the running server was charged, it stops at the end of its
+ *        budget or when it runs out of jobs*/
+void server_charge(void){
+  if (server.task->status == SUSPENDED){
+    server_deactivate();
+  }else if (server.budget == 0){
+    server_deactivate();
+    server_activate();
+  }else{
+    set_run_pool_head(server.task);
+  }
+}
+
+/**@brief queue an aperiodic job and wake the server if it ran out of jobs
+ * @return 1 if the server became runnable, 0 if not, -1 if the queue is
+ *         full or there is no server*/
+int job_submit(aperiodic_fn fn, void *arg){
+  if (server.task == NULL || fn == NULL) return -1;
+  if (job_count == JOB_QUEUE_SIZE) return -1;
+  uint32_t tail = (job_head + job_count) % JOB_QUEUE_SIZE;
+  job_queue[tail].fn = fn;
+  job_queue[tail].arg = arg;
+  job_count++;
+  if (server.task->status != SUSPENDED || !sched_started) return 0;
+  server_activate();
+  return 1;
+}
+
+int server_create(thread_fn fn, uint32_t *stack_start,
+                  unsigned int prio, unsigned int C, unsigned int T) {
+  if (server.task != NULL || C == 0) return -1;
+  int id = thread_spawn(fn, stack_start, prio, C, T);
+  if (id < 0) return -1;
+  //an online thread_spawn leaves IRQs masked until the dispatch
+  kernel_lock();
+  tcb_t *t = tcb_table[id];
+  clear_run_pool(t);
+  clear_wait_pool(t);
+  t->status = SUSPENDED;
+  server.task = t;
+  server.budget = C * US_PER_MS;
+  server.used = 0;
+  server.repl_head = 0;
+  server.repl_count = 0;
+  if (job_count > 0 && sched_started) server_activate();
+  if (sched_started){
+    request_dispatch();
+  }else{
+    kernel_unlock();
+  }
+  return 0;
+}
+
+int aperiodic_submit(aperiodic_fn fn, void *arg) {
+  kernel_lock();
+  int woke = job_submit(fn, arg);
+  if (woke == 1){
+    //the server may outrank us, IRQs stay masked until dispatch
+    request_dispatch();
+    return 0;
+  }
+  kernel_unlock();
+  return woke;
+}
+
+int aperiodic_submit_irq(aperiodic_fn fn, void *arg) {
+  //the irq handler reschedules on its way out
+#if CORE_NUM > 1
+  spin_lock(&sched_lock);
+#endif
+  int woke = job_submit(fn, arg);
+#if CORE_NUM > 1
+  spin_unlock(&sched_lock);
+#endif
+  return (woke < 0) ? -1 : 0;
+}
+
+int aperiodic_next(aperiodic_job_t *job) {
+  kernel_lock();
+  tcb_t *current_task = this_core()->current_task;
+  if (current_task != server.task || job == NULL){
+    kernel_unlock();
+    return -1;
+  }
+  if (job_count > 0){
+    *job = job_queue[job_head];
+    job_head = (job_head + 1) % JOB_QUEUE_SIZE;
+    job_count--;
+    kernel_unlock();
+    return 0;
+  }
+  //nothing to do, sleep until job_submit wakes us
+  current_task->status = SUSPENDED;
+  request_dispatch();
+  return -1;
+}
+
+int work_submit(aperiodic_fn fn, void *arg) {
+  disable_interrupts();
+  int ret = work_submit_irq(fn, arg);
+  enable_interrupts();
+  return ret;
+}
+
+int work_submit_irq(aperiodic_fn fn, void *arg) {
+  if (fn == NULL) return -1;
+  deque_entry_t entry = { .fn = fn, .arg = arg };
+  if (deque_push(&work_deques[this_core()->id], &entry)) return -1;
+  //wake idle cores sleeping in wfe
+  send_event();
+  return 0;
+}
+
+int work_take(aperiodic_job_t *job) {
+  if (job == NULL) return -1;
+  uint32_t id = this_core()->id;
+  deque_entry_t entry;
+  //our own work newest first, it is still warm in our cache
+  disable_interrupts();
+  int ret = deque_pop(&work_deques[id], &entry);
+  enable_interrupts();
+  //then the oldest work of the other cores
+  uint32_t k;
+  for (k = 1; ret && k < CORE_NUM; k++){
+    ret = deque_steal(&work_deques[(id + k) % CORE_NUM], &entry);
+  }
+  if (ret) return -1;
+  job->fn = entry.fn;
+  job->arg = entry.arg;
+  return 0;
+}
+
+/**@brief a job completed, check it against its deadline*/
+void job_done(tcb_t *t){
+  uint32_t time = task_core(t)->time;
+  clear_background(t);
+  if (t->ctx->job_state != JOB_UNTIMED){
+    hist_add(&t->ctx->hist.response, systimer_read() - t->ctx->release_us);
+    t->ctx->job_state = JOB_UNTIMED;
+  }
+  if (time > t->due){
+    t->ctx->misses++;
+    if (time - t->due > t->ctx->max_lateness) t->ctx->max_lateness = time - t->due;
+  }
+  t->due += t->period;
+}
+
+/**@brief a job ran past its computation time and is still subject to
+ *        enforcement*/
+int over_budget(tcb_t *t){
+  return t->budget < 0 && t->priority != IDLE_PRIO && !is_demoted(t);
+}
+
+/**@brief enforce the budget of a job that ran past its computation time,
+ *        never while it holds a mutex*/
+void overrun(tcb_t *t){
+  t->ctx->overruns++;
+  if (t->ctx->overrun_policy == OVERRUN_DEMOTE){
+    //keep running, but only when nothing else wants the cpu
+    set_background(t);
+    return;
+  }
+  if (t->ctx->overrun_policy == OVERRUN_HANDLER && t->ctx->overrun_handler != NULL){
+    //the handler runs on the sporadic server, the task is suspended
+    job_submit(t->ctx->overrun_handler, (void *)t->id);
+  }
+  //the job is abandoned and counts as a miss once, what is left of it
+  //runs as the next job against that job's deadline
+  uint32_t time = task_core(t)->time;
+  t->ctx->misses++;
+  if (time > t->due && time - t->due > t->ctx->max_lateness){
+    t->ctx->max_lateness = time - t->due;
+  }
+  t->status = WAITING;
+  t->budget = t->computation * US_PER_MS;
+  t->wakeup += t->period;
+  t->due = t->wakeup + t->period;
+  clear_run_pool(t);
+  set_wait_pool(t);
+}
+
+int thread_set_overrun(unsigned int tid, unsigned int policy,
+                       aperiodic_fn handler) {
+  if (tid >= THREAD_MAX || policy > OVERRUN_HANDLER) return -1;
+  if (policy == OVERRUN_HANDLER && handler == NULL) return -1;
+  kernel_lock();
+  tcb_t *t = tcb_table[tid];
+  if (t == NULL){
+    kernel_unlock();
+    return -1;
+  }
+  t->ctx->overrun_policy = policy;
+  t->ctx->overrun_handler = handler;
+  kernel_unlock();
+  return 0;
+}
+
+int thread_stats(unsigned int tid, thread_stats_t *stats) {
+  if (tid >= THREAD_MAX || stats == NULL) return -1;
+  kernel_lock();
+  tcb_t *t = tcb_table[tid];
+  if (t == NULL){
+    kernel_unlock();
+    return -1;
+  }
+  stats->overruns = t->ctx->overruns;
+  stats->misses = t->ctx->misses;
+  stats->max_lateness = t->ctx->max_lateness;
+  stats->long_holds = t->ctx->long_holds;
+  kernel_unlock();
+  return 0;
+}
+
+int thread_hist(unsigned int tid, thread_hist_t *hist) {
+  if (tid >= THREAD_MAX || hist == NULL) return -1;
+  kernel_lock();
+  tcb_t *t = tcb_table[tid];
+  if (t == NULL){
+    kernel_unlock();
+    return -1;
+  }
+  *hist = t->ctx->hist;
+  kernel_unlock();
+  return 0;
+}
+
+/**@brief print one histogram line for hist_dump*/
+void hist_print(uint32_t tid, const char *name, hist_t *h){
+  int i;
+  printk("hist %u %s max %u:", tid, name, h->max);
+  for (i = 0; i < HIST_BUCKETS; i++) printk(" %u", h->bucket[i]);
+  printk("\n");
+}
+
+int hist_dump(void) {
+  //copied one thread at a time, printing is too slow to keep IRQs masked
+  thread_hist_t hist;
+  uint32_t tid;
+  int n = 0;
+  budget_pause();
+  for (tid = 0; tid < THREAD_MAX; tid++){
+    if (thread_hist(tid, &hist)) continue;
+    hist_print(tid, "response", &hist.response);
+    hist_print(tid, "jitter", &hist.jitter);
+    n++;
+  }
+  budget_resume();
+  return n;
+}
+
+/**@brief heap_min_match filter: the task may run past the system ceiling
+ *        pointed to by arg, its preemption level is above it or it already
+ *        holds a mutex*/
+int srp_passes(uint32_t id, void *arg){
+  tcb_t *t = tcb_table[id];
+  return t->priority < *(uint32_t *)arg || t->ctx->held != MUTEX_NONE;
+}
+
+/**@brief earliest deadline runnable task under the stack resource policy:
+ *        a task holding no mutex may only start or preempt if its priority
+ *        (preemption level) is above the system ceiling, so the earliest
+ *        deadline task that is runs, and the holder of the ceiling only if
+ *        none is
+ * @return the task, or NULL if no task is runnable*/
+tcb_t *edf_next(core_t *core){
+  if (heap_empty(&core->edf_queue)) return NULL;
+  tcb_t *next = tcb_table[heap_min_id(&core->edf_queue)];
+  uint32_t ceiling = bitmap_first(&ceiling_map);
+  if (ceiling == BITMAP_NONE || srp_passes(next->id, &ceiling)) return next;
+
+  uint32_t id = heap_min_match(&core->edf_queue, srp_passes, &ceiling);
+  if (id != HEAP_NONE) return tcb_table[id];
+  tcb_t *holder = tcb_table[mutex_table[ceiling_head[ceiling]].mutex->thread];
+  if (holder->core == core->id && is_runnable(holder)) next = holder;
+  return next;
+}
+
+/**@brief take the microseconds the running task ran since it was last
+ *        charged out of its budget, or the server's, unless it is writing
+ *        a dump*/
+void charge(core_t *core){
+  tcb_t *t = core->current_task;
+  uint32_t now = systimer_read();
+  uint32_t ran = now - core->run_stamp;
+  core->run_stamp = now;
+  t->sleep += ran;
+  if (t->ctx->uncharged || t->priority == IDLE_PRIO) return;
+  if (t == server.task){
+    uint32_t spent = (ran < server.budget) ? ran : server.budget;
+    server.budget -= spent;
+    server.used += spent;
+  }else{
+    t->budget -= ran;
+  }
+}
+
+/**@brief charge the running task, release the tasks whose period has
+ *        come, and pick the task to run next on the calling core
+ * @return the task to run next*/
+tcb_t *find_next_task(void){
+  core_t *core = this_core();
+  tcb_t *current_task = core->current_task;
+  uint32_t time = core->time;
   uint32_t period = current_task->period;
-  uint32_t exec = current_task->execution;
-
-  if (current_task->status == RUNNING){
-    current_task->execution++;
-    current_task->sleep++;
-    //finished one round of task
-    if (exec >= current_task->computation){	
-      current_task->status = WAITING;
-      clear_run_pool(prio);
-      set_wait_pool(prio);
-      current_task->execution = 0;
-      current_task->wakeup += period;
+
+  //what it ran counts whatever it does now, a task that blocked or
+  //completed used the cpu up to here too
+  charge(core);
+  if (current_task == server.task){
+    if (current_task->status == RUNNING || current_task->status == SUSPENDED){
+      server_charge();
+    }
+  }else if (current_task->status == RUNNING){
+    //ran past its computation time, enforced once it holds no mutex so
+    //the tasks waiting for one are not held up for a period
+    if (over_budget(current_task) && current_task->ctx->held == MUTEX_NONE){
+      overrun(current_task);
     }else{
-      set_run_pool(prio);
-      clear_wait_pool(prio);
+      set_run_pool_head(current_task);
+      clear_wait_pool(current_task);
     }
   }else if (current_task->status == WAITING){		
    //suspended to wait until next period
-   set_wait_pool(prio);
-   clear_run_pool(prio);
-   current_task->execution = 0;
+   job_done(current_task);
+   current_task->budget = current_task->computation * US_PER_MS;
    current_task->wakeup += period;
+   set_wait_pool(current_task);
+   clear_run_pool(current_task);
+  }else if (current_task->status == EXITED){
+   clear_background(current_task);
+   //the tcb stays taken until the deadline of the job that exited, so a
+   //thread admitted in its place can not overload the current period
+   current_task->wakeup = current_task->deadline;
+   set_wait_pool(current_task);
+   clear_run_pool(current_task);
   }
-  //tasks in the waiting pool whose period has ended
-  int i;
-  for (i = 0; i < 31; i++){
-    if (is_waiting(i)&&(time >= tcb_list[i].wakeup)){
-      tcb_list[i].status = RUNNABLE;
-      tcb_list[i].execution = 0;
-      set_run_pool(i);
-      clear_wait_pool(i);
+  //tasks in the waiting pool whose period has ended, earliest first
+  while (!heap_empty(&core->release_queue) &&
+         time >= heap_min_key(&core->release_queue)){
+    tcb_t *t = tcb_table[heap_min_id(&core->release_queue)];
+    if (t->status == EXITED){
+      clear_wait_pool(t);
+      thread_free(t);
+      continue;
     }
-  }
-  //tasks in the runnable pool that has higher priority
-  int j;
-  for (j = 0; j < 31; j++){
-    if (is_runnable(j)&&(j <= prio)){
-      return j;
+    if (t == server.task){
+      //waited for a replenishment
+      clear_wait_pool(t);
+      if (job_count > 0){
+        server_activate();
+      }else{
+        t->status = SUSPENDED;
+      }
+      continue;
     }
+    t->status = RUNNABLE;
+    t->budget = t->computation * US_PER_MS;
+    t->deadline = t->wakeup + t->period;
+    set_run_pool(t);
+    clear_wait_pool(t);
+    t->ctx->release_us = systimer_read();
+    t->ctx->job_state = JOB_RELEASED;
+    trace(TRACE_RELEASE, t->id);
   }
-  return 31;
+  //demoted tasks whose period has ended are back to their own priority
+  while (!heap_empty(&core->restore_queue) &&
+         time >= heap_min_key(&core->restore_queue)){
+    tcb_t *t = tcb_table[heap_min_id(&core->restore_queue)];
+    clear_background(t);
+    t->wakeup += t->period;
+    t->budget = t->computation * US_PER_MS;
+    t->deadline = t->wakeup + t->period;
+    //one waiting for a mutex is queued when it gets it
+    if (t->status != BLOCKED) set_run_pool(t);
+  }
+  tcb_t *next;
+  if (sched_policy == SCHED_EDF){
+    next = edf_next(core);
+  }else{
+    //highest effective priority, a mutex holder is queued at the priority
+    //it inherited from the tasks it blocks
+    next = run_queue_first(&core->ready);
+  }
+  if (next == NULL) next = run_queue_first(&core->background);
+  if (next == NULL) next = &idle_list[core->id];
+  return next;
 }
 
-uint32_t* call_scheduler(uint32_t *sp) {
+#ifdef TICKLESS
+/**@brief advance core 0's `time` to the last millisecond boundary the
+ *        system timer has passed, the other cores keep a periodic tick*/
+void advance_time(void){
+  core_t *core = &cores[0];
+  uint32_t elapsed = (systimer_read() - core->time_stamp) / US_PER_MS;
+  core->time += elapsed;
+  core->time_stamp += elapsed * US_PER_MS;
+}
+
+/**@brief arm the system timer for the next release or budget expiry of
+ *        the task that is about to run on core 0. Releases fall on
+ *        millisecond boundaries, a budget runs out on the microsecond*/
+void program_next_event(void){
+  core_t *core = &cores[0];
+  tcb_t *current_task = core->current_task;
+  uint32_t time = core->time;
+  uint32_t next = time + TICKLESS_MAX_SLEEP;
+  if (!heap_empty(&core->release_queue) &&
+      heap_min_key(&core->release_queue) < next){
+    next = heap_min_key(&core->release_queue);
+  }
+  if (!heap_empty(&core->restore_queue) &&
+      heap_min_key(&core->restore_queue) < next){
+    next = heap_min_key(&core->restore_queue);
+  }
+  if (next <= time) next = time + 1;
+  uint32_t alarm = core->time_stamp + (next - time) * US_PER_MS;
+  //microseconds from the last charge until the budget runs out, all ones
+  //if it does not
+  uint32_t left = 0xffffffff;
+  if (current_task->ctx->uncharged){
+    //no budget runs out during a dump
+  }else if (current_task == server.task){
+    left = server.budget;
+  }else if (current_task->priority != IDLE_PRIO &&
+            !is_demoted(current_task) &&
+            current_task->ctx->held == MUTEX_NONE){
+    //the budget runs out once it drops below 0, a mutex holder is checked
+    //again when it unlocks
+    int32_t budget = current_task->budget;
+    left = (budget < 0) ? 0 : (uint32_t)budget + 1;
+  }
+  if (left != 0xffffffff &&
+      (int32_t)(core->run_stamp + left - alarm) < 0){
+    alarm = core->run_stamp + left;
+  }
+  systimer_set_alarm(alarm);
+}
+#endif
 
-  time++;
-  //printk("time:%d,runpool:%d, waitpool:%d, now:%d, nowxe:%d\n", time,runnable_pool,waiting_pool,current_task->priority, current_task->execution);
-  uint32_t next = find_next_task();
+void budget_pause(void) {
+  if (!sched_started) return;
+  kernel_lock();
+  core_t *core = this_core();
+  charge(core);
+  core->current_task->ctx->uncharged = 1;
+  kernel_unlock();
+}
 
-  //save register content into tcb
-  int i;
-  for (i = 0; i < TCB_REG_NUM; i++){
-    current_task->tcb_regs[i] = sp[i];
+void budget_resume(void) {
+  if (!sched_started) return;
+  kernel_lock();
+  core_t *core = this_core();
+  charge(core);
+  core->current_task->ctx->uncharged = 0;
+#ifdef TICKLESS
+  //the alarm was armed without a budget expiry meanwhile
+  if (core->id == 0) program_next_event();
+#endif
+  kernel_unlock();
+}
+
+/**@brief charge the running task, pick the next one and switch to it
+ * @param sp frame of the running task, on top of its kernel stack
+ * @return frame of the task to resume, sp itself when nothing switches*/
+uint32_t* schedule(uint32_t *sp) {
+
+  uint32_t start = read_cycle_count();
+#if CORE_NUM > 1
+  spin_lock(&sched_lock);
+#endif
+  core_t *core = this_core();
+  tcb_t *current_task = core->current_task;
+  tcb_t *next = find_next_task();
+
+  //the interrupted task keeps running: its frame is simply popped again
+  if (next != current_task || current_task->status != RUNNING){
+    //the frame on its kernel stack is all that is saved of the task
+    current_task->ctx->frame = sp;
+    if (next != current_task && current_task->status == RUNNING){
+      current_task->status = RUNNABLE;
+      clear_wait_pool(current_task);
+      set_run_pool_head(current_task);
+    }
+    //switch task, a mutex holder's critical sections stop the clock
+    //while it is switched out
+    if (next != current_task){
+      if (current_task->ctx->held != MUTEX_NONE){
+        current_task->ctx->hold_out = systimer_read();
+      }
+      if (next->ctx->held != MUTEX_NONE){
+        next->ctx->hold_preempted += systimer_read() - next->ctx->hold_out;
+      }
+    }
+    trace(TRACE_SWITCH, next->id);
+    if (next->ctx->job_state == JOB_RELEASED){
+      next->ctx->job_state = JOB_STARTED;
+      hist_add(&next->ctx->hist.jitter,
+               systimer_read() - next->ctx->release_us);
+    }
+    current_task = next;
+    core->current_task = current_task;
+    current_task->status = RUNNING;
+    clear_wait_pool(current_task);
+    clear_run_pool(current_task);
+    //the FPU stays off until the task uses it, unless it still holds the
+    //task's registers
+    write_fpexc(current_task == core->vfp_owner ? FPEXC_EN : 0);
+    sp = current_task->ctx->frame;
   }
-  if(current_task != NULL && next != current_task->priority && (!is_waiting(current_task->priority))){
-  current_task->status = RUNNABLE;
-  clear_wait_pool(current_task->priority);
-  set_run_pool(current_task->priority);
+#ifdef TICKLESS
+  if (core->id == 0) program_next_event();
+#endif
+  user_page_publish(core);
+  uint32_t cost = read_cycle_count() - start;
+  if (cost > sched_cost_max) sched_cost_max = cost;
+#if CORE_NUM > 1
+  spin_unlock(&sched_lock);
+#endif
+  return sp;
+}
+
+uint32_t* call_scheduler(uint32_t *sp) {
+  core_t *core = this_core();
+#ifdef TICKLESS
+  if (core->id == 0){
+    advance_time();
+    return schedule(sp);
   }
-  //switch task
-  current_task = &tcb_list[next];
-  current_task->status = RUNNING;
-  clear_wait_pool(current_task->priority);
-  clear_run_pool(current_task->priority);
-  
-  return (current_task->tcb_regs);
+#endif
+  core->time++;
+  return schedule(sp);
+}
+
+uint32_t* dispatch(uint32_t *sp) {
+#ifdef TICKLESS
+  if (this_core()->id == 0) advance_time();
+#endif
+  return schedule(sp);
+}
+
+#ifdef PROFILE
+void profile_sample(uint32_t *sp) {
+  tcb_t *current_task = this_core()->current_task;
+  profile_record(sp[LR_IRQ], current_task->id, current_task->curr_priority,
+                 (sp[SPSR_IRQ] & PSR_MODE) != PSR_MODE_USR);
+}
+#endif
+
+int vfp_trap(void) {
+  //the FPU was already on, the instruction is undefined for real
+  if (read_fpexc() & FPEXC_EN) return 0;
+  write_fpexc(FPEXC_EN);
+  core_t *core = this_core();
+  tcb_t *current_task = core->current_task;
+  //main() before scheduler_start() has no context to keep
+  if (current_task == NULL || current_task == core->vfp_owner) return 1;
+  if (core->vfp_owner != NULL) vfp_save(core->vfp_owner->ctx->vfp);
+  vfp_restore(current_task->ctx->vfp);
+  core->vfp_owner = current_task;
+  return 1;
 }
 
 int mutex_init(mutex_t *mutex, unsigned int max_prio) {
-    if (mutex == NULL) return -1;
+    if (mutex == NULL || max_prio >= PRIO_NUM) return -1;
+    kernel_lock();
+    if (mutex_count >= MUTEX_NUM){
+      kernel_unlock();
+      return -1;
+    }
 
-    mutex_list[mutex_index] = (uint32_t)mutex;
-    mutex_index++;
+    uint32_t id = mutex_count++;
+    mutex_table[id].mutex = mutex;
 
     mutex->lock = 0;
     mutex->ceiling = max_prio;
     mutex->thread = -1;
+    mutex->waiters = THREAD_NONE;
+    mutex->id = id;
+    //no task declared a critical section on it yet, once the scheduler
+    //runs every task has to stay schedulable with the ones that may lock it
+    if (sched_started){
+      uint32_t k;
+      for (k = 0; k < CORE_NUM; k++){
+        if (admit(k, 0, NULL)) break;
+      }
+      if (k < CORE_NUM){
+        mutex_count--;
+        mutex->id = MUTEX_NONE;
+        kernel_unlock();
+        return -1;
+      }
+    }
+    kernel_unlock();
     return 0;
 }
 
-void mutex_lock(mutex_t *mutex) {
-    while (mutex->lock){;}
+/**@brief check that a mutex went through mutex_init*/
+int mutex_valid(mutex_t *mutex){
+    return (mutex->id != MUTEX_NONE && mutex->id < mutex_count &&
+            mutex_table[mutex->id].mutex == mutex);
+}
 
-    disable_interrupts();
-    if ((current_task->curr_priority >= mutex->ceiling) && 
-        (current_task->curr_priority < mutex_ceiling)){
-      mutex->lock = 1;
-      mutex->thread = current_task->priority;
-      if (mutex->ceiling < mutex_ceiling){
-        mutex_ceiling = mutex->ceiling;
+int thread_hold(unsigned int tid, mutex_t *mutex, unsigned int us) {
+  if (tid >= THREAD_MAX || mutex == NULL) return -1;
+  kernel_lock();
+  tcb_t *t = tcb_table[tid];
+  //a task above the ceiling is not allowed to use this mutex
+  if (t == NULL || !mutex_valid(mutex) || t->priority < mutex->ceiling){
+    kernel_unlock();
+    return -1;
+  }
+  hold_decl_t *slot = NULL;
+  int i;
+  for (i = 0; i < HOLD_DECL_NUM; i++){
+    hold_decl_t *h = &t->ctx->holds[i];
+    if (h->mutex == mutex->id){
+      slot = h;
+      break;
+    }
+    if (h->mutex == MUTEX_NONE && slot == NULL) slot = h;
+  }
+  if (slot == NULL){
+    kernel_unlock();
+    return -1;
+  }
+  hold_decl_t old = *slot;
+  slot->mutex = mutex->id;
+  slot->us = us;
+  //once the scheduler runs, the tasks the section can block have to
+  //stay schedulable with it
+  if (sched_started && admit(t->ctx->place, 0, NULL)){
+    *slot = old;
+    kernel_unlock();
+    return -1;
+  }
+  kernel_unlock();
+  return 0;
+}
+
+/**@brief longest critical section a thread declared on a mutex
+ * @return microseconds, 0 if it declared none*/
+uint32_t hold_declared(tcb_t *t, uint32_t id){
+    int i;
+    for (i = 0; i < HOLD_DECL_NUM; i++){
+      if (t->ctx->holds[i].mutex == id) return t->ctx->holds[i].us;
+    }
+    return 0;
+}
+
+/**@brief mark a mutex held by a task: push it on its ceiling level and on
+ *        the owner's held list*/
+void mutex_hold(mutex_t *mutex, tcb_t *task){
+    uint32_t id = mutex->id;
+    mutex_rec_t *r = &mutex_table[id];
+    uint32_t c = mutex->ceiling;
+    uint32_t now = systimer_read();
+    mutex->lock = 1;
+    mutex->thread = task->id;
+    //a waiter handed the mutex is switched out holding it until it runs
+    if (cores[task->core].current_task != task){
+      if (task->ctx->held != MUTEX_NONE){
+        task->ctx->hold_preempted += now - task->ctx->hold_out;
       }
+      task->ctx->hold_out = now;
     }
-    enable_interrupts();
-    return;
+    r->lock_time = now;
+    r->lock_preempted = task->ctx->hold_preempted;
+
+    r->level_prev = MUTEX_NONE;
+    r->level_next = ceiling_head[c];
+    if (ceiling_head[c] != MUTEX_NONE){
+      mutex_table[ceiling_head[c]].level_prev = id;
+    }
+    ceiling_head[c] = id;
+    bitmap_set(&ceiling_map, c);
+    trace(TRACE_MUTEX_LOCK, id | task->id << 8);
+    trace(TRACE_CEILING, bitmap_first(&ceiling_map));
+
+    r->held_prev = MUTEX_NONE;
+    r->held_next = task->ctx->held;
+    if (task->ctx->held != MUTEX_NONE) mutex_table[task->ctx->held].held_prev = id;
+    task->ctx->held = id;
 }
 
-void mutex_unlock(mutex_t *mutex) {
-<<<<<<< HEAD
-    disable_interrupts();
+/**@brief undo mutex_hold, the ceiling level is cleared with its last mutex*/
+void mutex_release(mutex_t *mutex, tcb_t *task){
+    uint32_t id = mutex->id;
+    mutex_rec_t *r = &mutex_table[id];
+    uint32_t c = mutex->ceiling;
     mutex->lock = 0;
     mutex->thread = -1;
-    current_task->curr_priority = current_task->priority;
+    //the declaration is what admission counted on, check it held
+    uint32_t us = systimer_read() - r->lock_time -
+                  (task->ctx->hold_preempted - r->lock_preempted);
+    if (us > hold_declared(task, id)) task->ctx->long_holds++;
 
-    int i;
-    int sum = 0;
-    for (i = 0; i < mutex_index; i++){
-      mutex_t *m = (mutex_t *)mutex_list[i];
-      if (m->lock) sum += m->ceiling;
+    if (r->level_prev != MUTEX_NONE){
+      mutex_table[r->level_prev].level_next = r->level_next;
+    }else{
+      ceiling_head[c] = r->level_next;
+    }
+    if (r->level_next != MUTEX_NONE){
+      mutex_table[r->level_next].level_prev = r->level_prev;
+    }
+    if (ceiling_head[c] == MUTEX_NONE) bitmap_clear(&ceiling_map, c);
+    trace(TRACE_MUTEX_UNLOCK, id | task->id << 8);
+    trace(TRACE_CEILING, bitmap_first(&ceiling_map));
+
+    if (r->held_prev != MUTEX_NONE){
+      mutex_table[r->held_prev].held_next = r->held_next;
+    }else{
+      task->ctx->held = r->held_next;
+    }
+    if (r->held_next != MUTEX_NONE){
+      mutex_table[r->held_next].held_prev = r->held_prev;
+    }
+}
+
+/**@brief find the mutex that keeps a task from locking `mutex` under PCP:
+ *        the mutex itself if it is held, otherwise a mutex held by another
+ *        task at the system ceiling, unless the task's priority is above it.
+ *        Only ceiling levels the task holds itself are skipped.
+ * @return the blocking mutex, or NULL if the task may lock `mutex`*/
+mutex_t *lock_blocker(mutex_t *mutex, tcb_t *task){
+    if (mutex->lock) return mutex;
+
+    uint32_t c;
+    for (c = bitmap_first(&ceiling_map); c != BITMAP_NONE;
+         c = bitmap_next(&ceiling_map, c + 1)){
+      if (task->curr_priority < c) return NULL;
+      uint32_t id;
+      for (id = ceiling_head[c]; id != MUTEX_NONE;
+           id = mutex_table[id].level_next){
+        if (mutex_table[id].mutex->thread != (int)task->id){
+          return mutex_table[id].mutex;
+        }
+      }
+    }
+    return NULL;
+}
+
+/**@brief park a task on the wait queue of the mutex blocking it, behind
+ *        the waiters of the same or higher priority; the holder inherits
+ *        the task's priority*/
+void block_on(mutex_t *blocker, tcb_t *task){
+    uint32_t *link = &blocker->waiters;
+    while (*link != THREAD_NONE &&
+           tcb_table[*link]->priority <= task->priority){
+      link = &tcb_table[*link]->ctx->wait_next;
+    }
+    task->ctx->wait_next = *link;
+    *link = task->id;
+    task->status = BLOCKED;
+    clear_run_pool(task);
+    leave_background(task);
+    tcb_t *holder = tcb_table[blocker->thread];
+    if (task->curr_priority < holder->curr_priority){
+      set_curr_priority(holder, task->curr_priority);
+    }
+}
+
+/**@brief effective priority of a task: its own, or the highest priority of
+ *        a task waiting on a mutex it holds*/
+uint32_t inherited_priority(tcb_t *task){
+    uint32_t prio = task->priority;
+    uint32_t id;
+    for (id = task->ctx->held; id != MUTEX_NONE; id = mutex_table[id].held_next){
+      uint32_t waiter = mutex_table[id].mutex->waiters;
+      if (waiter != THREAD_NONE && tcb_table[waiter]->priority < prio){
+        prio = tcb_table[waiter]->priority;
+      }
     }
-    mutex_ceiling = sum;
-    enable_interrupts();
+    return prio;
+}
+
+/**@brief try again to take the mutex a blocked task wants; the mutex is
+ *        handed over directly, otherwise the task is parked again*/
+void retry_lock(tcb_t *task){
+    mutex_t *blocker = lock_blocker(task->ctx->want, task);
+    if (blocker != NULL){
+      block_on(blocker, task);
+      return;
+    }
+    mutex_hold(task->ctx->want, task);
+    task->ctx->want = NULL;
+    task->status = RUNNABLE;
+    set_run_pool(task);
+}
+
+void mutex_lock(mutex_t *mutex) {
+    kernel_lock();
+    tcb_t *current_task = this_core()->current_task;
+    //a task above the ceiling is not allowed to use this mutex
+    if (!mutex_valid(mutex) || current_task->priority < mutex->ceiling){
+      kernel_unlock();
+      return;
+    }
+    mutex_t *blocker = lock_blocker(mutex, current_task);
+    if (blocker == NULL){
+      mutex_hold(mutex, current_task);
+      kernel_unlock();
+      return;
+    }
+    //sleep until mutex_unlock hands the mutex over, IRQs stay masked until
+    //the next task is dispatched
+    current_task->ctx->want = mutex;
+    block_on(blocker, current_task);
+    request_dispatch();
+    return;
+}
+
+void mutex_unlock(mutex_t *mutex) {
+    kernel_lock();
+    tcb_t *current_task = this_core()->current_task;
+    if (!mutex_valid(mutex) || !mutex->lock ||
+        mutex->thread != (int)current_task->id){
+      kernel_unlock();
+      return;
+    }
+    uint32_t ceiling = bitmap_first(&ceiling_map);
+    mutex_release(mutex, current_task);
+
+    if (mutex->waiters == THREAD_NONE){
+      //SRP holds ready jobs back at the ceiling without queueing them on
+      //the mutex, a lower ceiling may let one of them preempt us now
+      if (sched_policy == SCHED_EDF && bitmap_first(&ceiling_map) != ceiling){
+        request_dispatch();
+        return;
+      }
+      //an overrun deferred while we held mutexes is enforced now
+      if (current_task->ctx->held == MUTEX_NONE && over_budget(current_task)){
+        request_dispatch();
+        return;
+      }
+      kernel_unlock();
+      return;
+    }
+
+    //highest priority waiter first, it may take the mutex right away
+    uint32_t w = mutex->waiters;
+    mutex->waiters = THREAD_NONE;
+    while (w != THREAD_NONE){
+      tcb_t *t = tcb_table[w];
+      //a waiter that blocks again is linked onto another list
+      w = t->ctx->wait_next;
+      retry_lock(t);
+    }
+    set_curr_priority(current_task, inherited_priority(current_task));
+
+    //a woken waiter may outrank us now, IRQs stay masked until dispatch
+    request_dispatch();
     return;
 }
 
 void wait_until_next_period(void) {
+    tcb_t *current_task = this_core()->current_task;
+    //the server has no periods of its own, its jobs just return
+    if (current_task == server.task) return;
+    //stays masked until the next task is dispatched from swi_asm_handler
+    kernel_lock();
     current_task->status = WAITING;
-    volatile uint32_t *status = &current_task->status;
-    while(*status == WAITING){;}
+    trace(TRACE_COMPLETE, current_task->id);
+    request_dispatch();
     return;
 }
 
 unsigned int get_time(void) {
-    return time;
+    core_t *core = this_core();
+#ifdef TICKLESS
+    //time only advances on scheduler events, add what passed since then
+    if (core->id == 0){
+      return core->time + (systimer_read() - core->time_stamp) / US_PER_MS;
+    }
+#endif
+    return core->time;
 }
 
-int scheduler_start(void) {
-    current_task = &tcb_list[31];      
-    current_task->execution = 0;
-    current_task->status = RUNNING;
+/**@brief highest ceiling of a mutex a thread may lock but declared no
+ *        critical section on
+ * @return the ceiling, PRIO_NUM if there is none*/
+uint32_t hold_undeclared(tcb_t *t){
+    uint32_t prio = PRIO_NUM;
+    uint32_t id;
+    for (id = 1; id < mutex_count; id++){
+      uint32_t c = mutex_table[id].mutex->ceiling;
+      if (c >= prio || c > t->priority) continue;
+      int i;
+      for (i = 0; i < HOLD_DECL_NUM; i++){
+        if (t->ctx->holds[i].mutex == id) break;
+      }
+      if (i == HOLD_DECL_NUM) prio = c;
+    }
+    return prio;
+}
 
-    float utest = 0.0;
+/**@brief longest critical section a thread runs on a mutex whose ceiling
+ *        is at or above a priority: the longest it declared, or its whole
+ *        computation time if it may lock such a mutex it declared nothing on
+ * @return microseconds*/
+uint32_t hold_longest(tcb_t *t, uint32_t prio){
+    if (hold_undeclared(t) <= prio) return t->computation * US_PER_MS;
+    uint32_t longest = 0;
     int i;
-    int thr_count = 0;
-    for (i = 0; i < 31; i++){
-      if (is_runnable(i)){
-	thr_count++;
-	//printk("i = %d, c = %d, T = %d", i, tcb_list[i].computation, tcb_list[i].period);
-        float u = ((float)tcb_list[i].computation)/((float)(tcb_list[i].period));
-	utest += u;
-        printk("i = %d, u = %d, utest = %d\n", i, u, utest);
+    for (i = 0; i < HOLD_DECL_NUM; i++){
+      hold_decl_t *h = &t->ctx->holds[i];
+      if (h->mutex != MUTEX_NONE && h->us > longest &&
+          mutex_table[h->mutex].mutex->ceiling <= prio){
+        longest = h->us;
+      }
+    }
+    return longest;
+}
+
+/**@brief highest priority a thread can delay: its own, or the highest
+ *        ceiling of a mutex it declared a critical section on or may lock
+ *        undeclared*/
+uint32_t hold_reach(tcb_t *t){
+    uint32_t prio = t->priority;
+    uint32_t c = hold_undeclared(t);
+    if (c < prio) prio = c;
+    int i;
+    for (i = 0; i < HOLD_DECL_NUM; i++){
+      hold_decl_t *h = &t->ctx->holds[i];
+      if (h->mutex != MUTEX_NONE && mutex_table[h->mutex].mutex->ceiling < prio){
+        prio = mutex_table[h->mutex].mutex->ceiling;
+      }
+    }
+    return prio;
+}
+
+/**@brief PCP blocking of a task in microseconds: the longest critical
+ *        section of a lower priority task on the same core on a
+ *        mutex whose ceiling is at or above the task's priority*/
+uint32_t pcp_blocking(tcb_t *t){
+    uint32_t block = 0;
+    tcb_t *j;
+    //thread_list is in priority order, lower priorities come after t
+    for (j = t->ctx->list_next; j != NULL; j = j->ctx->list_next){
+      if (j->ctx->place != t->ctx->place || j->priority <= t->priority){
+        continue;
+      }
+      uint32_t us = hold_longest(j, t->priority);
+      if (us > block) block = us;
+    }
+    return block;
+}
+
+/**@brief SRP blocking within [0, L] in ms, rounded up: one critical
+ *        section of a task with a later relative deadline on a
+ *        mutex whose ceiling is at or above the preemption level of a task
+ *        with a deadline inside L*/
+uint32_t edf_blocking(uint32_t core, uint32_t L){
+    uint32_t level = 0;
+    tcb_t *t;
+    for (t = thread_list; t != NULL; t = t->ctx->list_next){
+      if (t->ctx->place == core && t->period <= L) level = t->priority;
+    }
+    uint32_t block = 0;
+    for (t = thread_list; t != NULL; t = t->ctx->list_next){
+      if (t->ctx->place != core || t->period <= L) continue;
+      uint32_t us = hold_longest(t, level);
+      if (us > block) block = us;
+    }
+    return (block + US_PER_MS - 1) / US_PER_MS;
+}
+
+/**@brief processor demand test for EDF with implicit deadlines and SRP:
+ *        utilization at most 1, and demand plus blocking never exceeding
+ *        the interval at any deadline L. Blocking is 0 from the longest
+ *        period on and, with U < 1, demand plus blocking stays below L
+ *        from L* = Bmax / (1 - U) on, so only deadlines below both are
+ *        tested; both are at most the hyperperiod. The deadlines of all
+ *        tasks are merged through edf_points, so each L is tested once,
+ *        and the demand grows by one job per deadline. After EDF_MAX_POINTS
+ *        deadlines the rest is bounded at once: demand stays at most U*L
+ *        and blocking does not grow, so U*L + B(L) <= L at the last tested
+ *        L holds for every later one. The test then may reject a feasible
+ *        set, but its work is bounded for online admission.
+ * @param core only the tasks placed on this core are tested
+ * @return 0 if the task set is schedulable, -1 if not*/
+int edf_admit(uint32_t core){
+    //U = sum C/T exactly over the hyperperiod H when H fits 32 bits
+    uint64_t H = 1;
+    uint64_t work = 0;
+    //otherwise U in 32.32 fixed point, rounded up
+    uint64_t one = 1ULL << 32;
+    uint64_t u = 0;
+    uint32_t tmax = 0;
+    tcb_t *t;
+    for (t = thread_list; t != NULL; t = t->ctx->list_next){
+      if (t->ctx->place != core) continue;
+      uint32_t C = t->computation;
+      uint32_t T = t->period;
+      u += (((uint64_t)C << 32) + T - 1) / T;
+      if (T > tmax) tmax = T;
+      if (H != 0){
+        uint64_t a = H, b = T;
+        while (b != 0){
+          uint64_t r = a % b;
+          a = b;
+          b = r;
+        }
+        H = H / a * T;
+        if (H > 0xffffffff) H = 0;
+      }
+    }
+    if (H != 0){
+      for (t = thread_list; t != NULL; t = t->ctx->list_next){
+        if (t->ctx->place == core) work += t->computation * (H / t->period);
+      }
+      if (work > H) return -1;
+    }else if (u > one){
+      return -1;
+    }
+
+    uint32_t bmax = 0;
+    for (t = thread_list; t != NULL; t = t->ctx->list_next){
+      if (t->ctx->place != core) continue;
+      uint32_t us = hold_longest(t, IDLE_PRIO);
+      if (us > bmax) bmax = us;
+    }
+    bmax = (bmax + US_PER_MS - 1) / US_PER_MS;
+    //without blocking U <= 1 is exact for implicit deadlines
+    if (bmax == 0) return 0;
+
+    uint64_t limit = tmax;
+    if (H != 0 && work < H){
+      uint64_t lstar = (uint64_t)bmax * H / (H - work);
+      if (lstar < limit) limit = lstar;
+    }else if (H == 0 && u < one){
+      uint64_t lstar = ((uint64_t)bmax << 32) / (one - u);
+      if (lstar < limit) limit = lstar;
+    }
+
+    heap_init(&edf_points);
+    for (t = thread_list; t != NULL; t = t->ctx->list_next){
+      if (t->ctx->place == core && t->period <= limit){
+        heap_insert(&edf_points, t->id, t->period);
+      }
+    }
+    uint64_t demand = 0;
+    uint32_t block = 0;
+    uint32_t points = 0;
+    while (!heap_empty(&edf_points)){
+      uint32_t L = heap_min_key(&edf_points);
+      int first = 0;
+      while (!heap_empty(&edf_points) && heap_min_key(&edf_points) == L){
+        t = tcb_table[heap_min_id(&edf_points)];
+        demand += t->computation;
+        if (L == t->period) first = 1;
+        if ((uint64_t)L + t->period <= limit){
+          heap_insert(&edf_points, t->id, L + t->period);
+        }else{
+          heap_remove(&edf_points, t->id);
+        }
+      }
+      //blocking only changes where a period starts to fit into L
+      if (first) block = edf_blocking(core, L);
+      if (demand + block > L) return -1;
+      if (++points == EDF_MAX_POINTS && !heap_empty(&edf_points)){
+        //(1 - U) L >= B(L)
+        if (H != 0) return ((H - work) * L >= (uint64_t)block * H) ? 0 : -1;
+        return ((one - u) * L >= ((uint64_t)block << 32)) ? 0 : -1;
       }
     }
-    if (utest > utilization_list[thr_count]) return -1;
+    return 0;
+}
+
+/**@brief response time analysis for fixed priorities, in microseconds:
+ *        R_i = C_i + B_i + sum over every other task j at the same or a
+ *        higher priority of ceil(R_i/T_j) C_j, where every job is charged
+ *        two scheduler passes, B_i is the longest critical section of a
+ *        lower priority task on a mutex with a ceiling at or above i (its
+ *        whole C_j if it declared none on such a mutex it may lock), and
+ *        the periodic tick is charged one pass per millisecond
+ * @param core only the tasks placed on this core are analysed
+ * @param from only tasks at or below this priority are analysed
+ * @param wcrt filled with the response time of every analysed task, by
+ *        thread id, may be NULL
+ * @return 0 if the task set is schedulable, -1 if not*/
+int rta_admit(uint32_t core, uint32_t from, uint32_t *wcrt){
+    uint64_t cs = sched_cost_max / CPU_MHZ;
+    if (cs < SCHED_COST_US) cs = SCHED_COST_US;
+
+    int ok = 0;
+    tcb_t *t;
+    for (t = thread_list; t != NULL; t = t->ctx->list_next){
+      if (t->ctx->place != core || t->priority < from) continue;
+      uint64_t T = (uint64_t)t->period * US_PER_MS;
+      uint64_t B = pcp_blocking(t);
+      uint64_t base = (uint64_t)t->computation * US_PER_MS + B + 2 * cs;
+
+      uint64_t R = base;
+      uint64_t prev = 0;
+      while (R != prev && R <= T){
+        prev = R;
+        R = base;
+#ifndef TICKLESS
+        R += ((prev + US_PER_MS - 1) / US_PER_MS) * cs;
+#endif
+        //tasks sharing the priority run first come first served, count
+        //them like higher priority tasks
+        tcb_t *j;
+        for (j = thread_list; j != NULL && j->priority <= t->priority;
+             j = j->ctx->list_next){
+          if (j == t || j->ctx->place != core) continue;
+          uint64_t Tj = (uint64_t)j->period * US_PER_MS;
+          uint64_t Cj = (uint64_t)j->computation * US_PER_MS + 2 * cs;
+          R += ((prev + Tj - 1) / Tj) * Cj;
+        }
+      }
+      if (wcrt != NULL) wcrt[t->id] = (R > 0xffffffff) ? 0xffffffff : R;
+      if (R > T) ok = -1;
+    }
+    return ok;
+}
+
+/**@brief run the admission test of the current policy on the tasks placed
+ *        on a core, `from` lets fixed priorities skip tasks a new one can
+ *        not delay
+ * @return 0 if the task set is schedulable, -1 if not*/
+int admit(uint32_t core, uint32_t from, uint32_t *wcrt){
+    if (sched_policy == SCHED_EDF){
+      //EDF guarantees every job finishes by its deadline, one period
+      int ok = edf_admit(core);
+      if (wcrt != NULL){
+        tcb_t *t;
+        for (t = thread_list; t != NULL; t = t->ctx->list_next){
+          if (t->ctx->place == core) wcrt[t->id] = t->period * US_PER_MS;
+        }
+      }
+      return ok;
+    }
+    return rta_admit(core, from, wcrt);
+}
+
+/**@brief first-fit decreasing bin packing of the threads not placed yet:
+ *        the one with the highest utilization goes first, onto the first
+ *        core whose admission test still passes with it
+ * @return 0 if every thread found a core, -1 if not*/
+int partition(void){
+    while (1){
+      tcb_t *best = NULL;
+      tcb_t *t;
+      for (t = thread_list; t != NULL; t = t->ctx->list_next){
+        if (t->ctx->place != CORE_NONE) continue;
+        if (best == NULL ||
+            (uint64_t)t->computation * best->period >
+            (uint64_t)best->computation * t->period){
+          best = t;
+        }
+      }
+      if (best == NULL) return 0;
+      uint32_t k;
+      uint32_t from = hold_reach(best);
+      for (k = 0; k < CORE_NUM; k++){
+        best->ctx->place = k;
+        if (admit(k, from, NULL) == 0) break;
+      }
+      if (k == CORE_NUM){
+        best->ctx->place = CORE_NONE;
+        return -1;
+      }
+    }
+}
+
+/**@brief let partition() place every thread from scratch*/
+void unplace_threads(void){
+    tcb_t *t;
+    for (t = thread_list; t != NULL; t = t->ctx->list_next) t->ctx->place = CORE_NONE;
+}
+
+/**@brief count every thread on the core it runs on again*/
+void restore_places(void){
+    tcb_t *t;
+    for (t = thread_list; t != NULL; t = t->ctx->list_next) t->ctx->place = t->core;
+}
 
-    time = 0;
-    enable_interrupts();
+int scheduler_admit(uint32_t *wcrt) {
+    if (wcrt != NULL){
+      int i;
+      for (i = 0; i < THREAD_MAX; i++) wcrt[i] = 0;
+    }
+    kernel_lock();
+    unplace_threads();
+    int ok = partition();
+    if (ok){
+      //report the task set as if it all ran on one core
+      tcb_t *t;
+      for (t = thread_list; t != NULL; t = t->ctx->list_next) t->ctx->place = 0;
+      admit(0, 0, wcrt);
+    }else{
+      uint32_t k;
+      for (k = 0; k < CORE_NUM; k++) admit(k, 0, wcrt);
+    }
+    restore_places();
+    kernel_unlock();
+    return ok;
+}
+
+int scheduler_set_policy(unsigned int policy) {
+    if (sched_started) return -1;
+    if (policy != SCHED_RM && policy != SCHED_EDF) return -1;
+    sched_policy = policy;
+    return 0;
+}
+
+/**@brief make the idle task current on the calling core and reset its
+ *        clock*/
+void core_start(core_t *core){
+    core->current_task = &idle_list[core->id];
+    core->current_task->status = RUNNING;
+    core->time = 0;
+    core->run_stamp = systimer_read();
+    //whatever main() left in the FPU belongs to nobody
+    core->vfp_owner = NULL;
+    write_fpexc(0);
+    user_page_publish(core);
+}
+
+int scheduler_start(void) {
+    unplace_threads();
+    if (partition()){
+      restore_places();
+      return -1;
+    }
+
+    //thread_create queued every task on core 0, move them to their cores;
+    //this also queues tasks created before SCHED_EDF was chosen
+    tcb_t *t;
+    uint32_t now = systimer_read();
+    for (t = thread_list; t != NULL; t = t->ctx->list_next){
+      uint32_t runnable = is_runnable(t);
+      if (runnable) clear_run_pool(t);
+      t->core = t->ctx->place;
+      if (runnable) set_run_pool(t);
+      //the first jobs are released now
+      if (runnable && t != server.task){
+        t->ctx->release_us = now;
+        t->ctx->job_state = JOB_RELEASED;
+      }
+    }
+
+    core_start(&cores[0]);
+    if (server.task != NULL && job_count > 0) server_activate();
+    sched_started = 1;
+    //let cores 1-3 out of scheduler_start_secondary
+    send_event();
+    //the first tick must find the idle task in user mode, not us
+    disable_interrupts();
+#ifdef TICKLESS
+    cores[0].time_stamp = systimer_read();
+    systimer_set_alarm(cores[0].time_stamp + US_PER_MS);
+#else
     timer_start(1000);
-    while(1){;}
+#endif
+    //leave this syscall for good, the idle task runs until the first tick
+    idle_enter(cores[0].current_task->ctx->frame);
     return 0;
 }
 
+void scheduler_start_secondary(void) {
+    core_t *core = this_core();
+    volatile uint32_t *started = &sched_started;
+    while (!*started) wait_event();
+
+    spin_lock(&sched_lock);
+    core_start(core);
+    spin_unlock(&sched_lock);
+    smp_timer_start(core->id, 1000);
+    idle_enter(core->current_task->ctx->frame);
+}
+
 unsigned int get_priority(void) {
-    return current_task->priority;
+    return this_core()->current_task->curr_priority;
+}
+
+/**@brief microseconds the current task has run, including the part not
+ *        yet charged by the scheduler*/
+uint32_t task_runtime(void) {
+    core_t *core = this_core();
+    //read sleep first, a scheduler pass in between can only undercount
+    uint32_t sleep = *(volatile uint32_t *)&core->current_task->sleep;
+    uint32_t stamp = *(volatile uint32_t *)&core->run_stamp;
+    return sleep + (systimer_read() - stamp);
 }
 
 void spin_wait(unsigned ms) {
-    current_task->sleep = 0;
-    volatile uint32_t *s = &current_task->sleep;
-    while(*s < ms){;}
+    uint32_t start = task_runtime();
+    while(task_runtime() - start < ms * US_PER_MS){;}
     return;
 }
@@ -0,0 +1,63 @@
+/**
+ * @file   systimer.c
+ *
+ * @brief  Implementation of routines for the BCM2835 system timer
+ *
+ * @date   10.15.2026
+ * @author yanyingz
+ */
+
+#include <systimer.h>
+#include <BCM2836.h>
+#include <kstdint.h>
+
+/**@brief define the base register for the system timer*/
+#define SYSTIMER_BASE (MMIO_BASE_PHYSICAL + 0x3000)
+/**@brief define the control/status register*/
+#define CS_REG (volatile uint32_t *) (SYSTIMER_BASE + 0x0)
+/**@brief define the counter lower 32 bits register*/
+#define CLO_REG (volatile uint32_t *) (SYSTIMER_BASE + 0x4)
+/**@brief define the compare 1 register*/
+#define C1_REG (volatile uint32_t *) (SYSTIMER_BASE + 0x10)
+/**@brief define the irq pending 1 register*/
+#define IRQ_PENDING_1 (volatile uint32_t *) (MMIO_BASE_PHYSICAL + 0xb204)
+/**@brief define the irq enable 1 register*/
+#define IRQ_ENABLE_1 (volatile uint32_t *) (MMIO_BASE_PHYSICAL + 0xb210)
+/**@brief define the irq disable 1 register*/
+#define IRQ_DISABLE_1 (volatile uint32_t *) (MMIO_BASE_PHYSICAL + 0xb21c)
+/**@brief compare channel 1 match bit, also its irq number*/
+#define M1 (1 << 1)
+/**@brief closest alarm that is still guaranteed to be seen by the compare*/
+#define MIN_ALARM_US 5
+
+uint32_t systimer_read(void) {
+  return *CLO_REG;
+}
+
+
+void systimer_set_alarm(uint32_t us) {
+  uint32_t now = *CLO_REG;
+  //the compare only matches on equality, so never arm it in the past
+  if ((int32_t)(us - now) < MIN_ALARM_US) us = now + MIN_ALARM_US;
+  *C1_REG = us;
+  *CS_REG = M1;
+  *IRQ_ENABLE_1 = M1;
+  return;
+}
+
+
+void systimer_stop(void) {
+  *IRQ_DISABLE_1 = M1;
+  return;
+}
+
+
+int systimer_is_pending(void) {
+  return ((*IRQ_PENDING_1 & M1) != 0);
+}
+
+
+void systimer_clear_pending(void) {
+  *CS_REG = M1;
+  return;
+}
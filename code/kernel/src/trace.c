@@ -0,0 +1,115 @@
+/**
+ * @file   trace.c
+ *
+ * @brief  Per-core scheduler event rings and their binary dump. The cycle
+ *         counters of the cores are not related to each other, so each ring
+ *         pairs a cycle reading with the shared system timer every time it
+ *         wraps; the host converter places all cores on the system timer
+ *         through these pairs.
+ *
+ *         Dump format, little endian words:
+ *           "TRC1", CPU_MHZ, CORE_NUM, then per core
+ *           sync index, sync cycles, sync us, count, count events
+ *         where events run oldest first and the sync index is the position
+ *         of the event whose cycles match the sync pair.
+ *
+ * @date   10.16.2026
+ * @author yanyingz
+ */
+
+#include <kstdint.h>
+#include <BCM2836.h>
+#include <arm.h>
+#include <smp.h>
+#include <systimer.h>
+#include <uart.h>
+#include <syscalls.h>
+#include <trace.h>
+
+#ifdef TRACE
+
+/**@brief cycles a core may still spend in trace_record after recording
+ *        was switched off*/
+#define TRACE_SETTLE	1000
+
+trace_ring_t trace_rings[CORE_NUM];
+/**@brief cleared while a dump reads the rings*/
+volatile uint32_t trace_on = 1;
+/**@brief set while a dump is running*/
+volatile uint32_t trace_dumping;
+
+void trace_record(uint32_t type, uint32_t arg){
+  if (!trace_on) return;
+  trace_ring_t *r = &trace_rings[get_core_id()];
+  uint32_t now = read_cycle_count();
+  uint32_t slot = r->head & (TRACE_EVENTS - 1);
+  if (slot == 0){
+    //keep a sync pair inside the events the ring still holds
+    r->sync_head = r->head;
+    r->sync_cycles = now;
+    r->sync_us = systimer_read();
+  }
+  trace_event_t *e = &r->event[slot];
+  e->cycles = now;
+  e->arg = arg;
+  e->type = type;
+  r->head++;
+}
+
+/**@brief send a word over UART, least significant byte first*/
+static void put_word(uint32_t w){
+  uart_put_byte(w);
+  uart_put_byte(w >> 8);
+  uart_put_byte(w >> 16);
+  uart_put_byte(w >> 24);
+}
+
+int trace_dump(void){
+  if (!compare_and_swap(&trace_dumping, 0, 1)) return -1;
+  budget_pause();
+  trace_on = 0;
+  memory_barrier();
+  //recording runs with IRQs masked, an event already underway finishes
+  //well within this
+  delay_cycles(TRACE_SETTLE);
+
+  int total = 0;
+  uint32_t core;
+  uart_put_byte('T');
+  uart_put_byte('R');
+  uart_put_byte('C');
+  uart_put_byte('1');
+  put_word(CPU_MHZ);
+  put_word(CORE_NUM);
+  for (core = 0; core < CORE_NUM; core++){
+    trace_ring_t *r = &trace_rings[core];
+    uint32_t count = r->head < TRACE_EVENTS ? r->head : TRACE_EVENTS;
+    uint32_t first = r->head - count;
+    uint32_t i;
+    put_word(count == 0 ? 0 : r->sync_head - first);
+    put_word(r->sync_cycles);
+    put_word(r->sync_us);
+    put_word(count);
+    for (i = first; i != r->head; i++){
+      trace_event_t *e = &r->event[i & (TRACE_EVENTS - 1)];
+      put_word(e->cycles);
+      put_word(e->arg | (uint32_t)e->type << 16);
+    }
+    total += count;
+    r->head = 0;
+  }
+
+  memory_barrier();
+  trace_on = 1;
+  trace_dumping = 0;
+  budget_resume();
+  return total;
+}
+
+#else
+
+int trace_dump(void){
+  return -1;
+}
+
+#endif
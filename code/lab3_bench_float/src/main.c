@@ -0,0 +1,127 @@
+/**
+ * @file   main.c
+ *
+ * @brief  Benchmark for float-heavy tasks. Two threads run the same double
+ *         precision loop; the longer jobs of the second are preempted by
+ *         the first mid-loop, so the kernel has to move the FPU between
+ *         them. A third thread never touches the FPU. Each job reports the
+ *         fastest run of the loop and how many runs no longer matched the
+ *         result main() computed alone. Building with -mfloat-abi=soft in
+ *         config.mk times the emulated version of the same loop.
+ */
+
+#include <stdio.h>
+#include <syscall_thread.h>
+#include <cycle_count.h>
+
+/** @brief Iterations of one run of the loop */
+#define LOOP_ITERATIONS 10000
+
+/** @brief thread user space stack size - 4KB */
+#define USR_STACK_WORDS 1024
+
+uint32_t idle_stack[USR_STACK_WORDS];
+uint32_t thread1_stack[USR_STACK_WORDS];
+uint32_t thread2_stack[USR_STACK_WORDS];
+uint32_t thread3_stack[USR_STACK_WORDS];
+
+/** @brief Loop input, volatile so the compiler cannot fold the loop */
+volatile double seed = 0.5;
+
+/** @brief Result of the loop without any context switch */
+double expected;
+
+/** @brief Default idle thread which just loops infinitely */
+void idle_thread(void) {
+  while(1);
+}
+
+/** @brief The float workload, a damped pair of recurrences
+ *
+ *  @return the final state
+ */
+double workload(void) {
+  double x = seed;
+  double y = 1.0 - seed;
+  int i;
+  for (i = 0; i < LOOP_ITERATIONS; i++) {
+    x = x * 0.999 + y * 0.001;
+    y = y * 0.998 + x * 0.002 + 0.0001;
+  }
+  return x + y;
+}
+
+/** @brief Runs the workload back to back every period and reports it
+ *
+ *  @param name label of the thread in the output
+ *  @param window_ms keep starting runs for this long, 0 for a single run
+ */
+void float_job(const char *name, unsigned int window_ms) {
+  uint32_t errors = 0;
+  uint32_t runs = 0;
+  while(1) {
+    uint32_t min = 0xffffffff;
+    unsigned int end = get_time() + window_ms;
+    do {
+      uint32_t start = read_cycle_count();
+      double result = workload();
+      uint32_t cycles = read_cycle_count() - start;
+      if (result != expected) errors++;
+      if (cycles < min) min = cycles;
+      runs++;
+    } while (get_time() < end);
+    printf("%s --- loop cycles: %u wrong results: %u/%u\n", name,
+           (unsigned)min, (unsigned)errors, (unsigned)runs);
+    wait_until_next_period();
+  }
+}
+
+void thread_1(void) {
+  float_job("float 1", 0);
+}
+
+void thread_2(void) {
+  float_job("float 2", 30);
+}
+
+/** @brief Integer only thread, its switches should not touch the FPU */
+void thread_3(void) {
+  while(1) {
+    spin_wait(5);
+    wait_until_next_period();
+  }
+}
+
+int main(void) {
+  int status;
+  expected = workload();
+
+  status = thread_init(&idle_thread, &idle_stack[USR_STACK_WORDS-1]);
+  if (status) {
+    printf("Failed to initialize thread library: %d\n", status);
+    return 1;
+  }
+
+  status = thread_create(&thread_3, &thread3_stack[USR_STACK_WORDS-1],
+          0, 10, 50);
+  status += thread_create(&thread_1, &thread1_stack[USR_STACK_WORDS-1],
+          1, 20, 100);
+  status += thread_create(&thread_2, &thread2_stack[USR_STACK_WORDS-1],
+          2, 40, 200);
+
+  if (status) {
+    printf("Failed to create one of the threads!\n");
+    return 1;
+  } else {
+    printf("Successfully created threads! Starting scheduler...\n");
+  }
+
+  status = scheduler_start();
+  if (status) {
+    printf("Threads are unschedulable! %d\n", status);
+    return 1;
+  }
+
+  // Should never get here.
+  return 2;
+}
@@ -0,0 +1,160 @@
+/**
+ * @file   main.c
+ *
+ * @brief  Benchmark for the cost of mutex_lock() and mutex_unlock(). A
+ *         background thread holds the mutex nearly all the time. A high
+ *         priority thread with a 2 ms period wakes up while it does and
+ *         takes these samples per job:
+ *
+ *         lock_contended: from its mutex_lock() call to the holder running
+ *         again, so the syscall, the priority inheritance and the switch.
+ *
+ *         unlock_contended: from the holder's mutex_unlock() call to the
+ *         waiter returning from mutex_lock() with the mutex, so the
+ *         syscall, the hand over and the switch back.
+ *
+ *         lock and unlock: BATCH lock/unlock pairs on the then free mutex.
+ *
+ *         The holder prints the reports, the measuring thread skips its
+ *         samples meanwhile.
+ */
+
+#include <stdio.h>
+#include <mutex.h>
+#include <syscall_thread.h>
+#include <bench.h>
+
+/** @brief Samples of each kind per report */
+#define SAMPLES 2000
+
+/** @brief Uncontended lock/unlock pairs timed per job */
+#define BATCH 8
+
+/** @brief thread user space stack size - 1KB */
+#define USR_STACK_WORDS 256
+
+uint32_t idle_stack[USR_STACK_WORDS];
+uint32_t bench_stack[USR_STACK_WORDS];
+uint32_t holder_stack[USR_STACK_WORDS];
+
+uint32_t lock_samples[SAMPLES];
+uint32_t unlock_samples[SAMPLES];
+uint32_t block_samples[SAMPLES];
+uint32_t handoff_samples[SAMPLES];
+
+bench_t lock_bench = BENCH_INIT("lock", lock_samples);
+bench_t unlock_bench = BENCH_INIT("unlock", unlock_samples);
+bench_t block_bench = BENCH_INIT("lock_contended", block_samples);
+bench_t handoff_bench = BENCH_INIT("unlock_contended", handoff_samples);
+
+mutex_t mutex;
+
+/** @brief 1 while the holder has the mutex */
+volatile uint32_t held;
+/** @brief set by the measuring thread just before it blocks on the mutex */
+volatile uint32_t blocked;
+/** @brief cycle count at which the measuring thread called mutex_lock() */
+volatile uint32_t block_stamp;
+/** @brief cycle count at which the holder called mutex_unlock() */
+volatile uint32_t unlock_stamp;
+/** @brief the holder's last lock_contended sample */
+volatile uint32_t block_cycles;
+/** @brief 1 while the holder prints the reports */
+volatile uint32_t report;
+
+/** @brief cost of reading the cycle counter twice */
+uint32_t base;
+
+/** @brief Default idle thread which just loops infinitely */
+void idle_thread(void) {
+  while(1);
+}
+
+/** @brief Background thread which keeps the mutex until someone waits */
+void holder_thread(void) {
+  while(1) {
+    if (report) {
+      bench_report(&lock_bench);
+      bench_report(&unlock_bench);
+      bench_report(&block_bench);
+      bench_report(&handoff_bench);
+      report = 0;
+    }
+    mutex_lock(&mutex);
+    held = 1;
+    // the measuring thread only lets us run again once it has blocked
+    while (!blocked);
+    block_cycles = read_cycle_count() - block_stamp - base;
+    held = 0;
+    blocked = 0;
+    unlock_stamp = read_cycle_count();
+    mutex_unlock(&mutex);
+  }
+}
+
+/** @brief Measuring thread, samples each kind once per job */
+void bench_thread(void) {
+  base = bench_overhead();
+  while(1) {
+    if (!report && held) {
+      block_stamp = read_cycle_count();
+      blocked = 1;
+      mutex_lock(&mutex);
+      uint32_t wake = read_cycle_count();
+      bench_add(&block_bench, block_cycles);
+      bench_add(&handoff_bench, wake - unlock_stamp - base);
+      mutex_unlock(&mutex);
+
+      int i;
+      for (i = 0; i < BATCH; i++) {
+        uint32_t start = read_cycle_count();
+        mutex_lock(&mutex);
+        uint32_t locked = read_cycle_count();
+        mutex_unlock(&mutex);
+        uint32_t end = read_cycle_count();
+        bench_add(&lock_bench, locked - start - base);
+        bench_add(&unlock_bench, end - locked - base);
+      }
+      if (block_bench.count == SAMPLES) report = 1;
+    }
+    wait_until_next_period();
+  }
+}
+
+int main(void) {
+  int status;
+  status = thread_init(&idle_thread, &idle_stack[USR_STACK_WORDS-1]);
+  if (status) {
+    printf("Failed to initialize thread library: %d\n", status);
+    return 1;
+  }
+
+  status = thread_create(&bench_thread, &bench_stack[USR_STACK_WORDS-1],
+          0, 1, 2);
+  // the holder overruns its budget at once and runs in the background
+  status += thread_create(&holder_thread, &holder_stack[USR_STACK_WORDS-1],
+          1, 1, 1000);
+  status += thread_set_overrun(1, OVERRUN_DEMOTE, NULL);
+
+  if (status) {
+    printf("Failed to create one of the threads!\n");
+    return 1;
+  } else {
+    printf("Successfully created threads! Starting scheduler...\n");
+  }
+
+  status = mutex_init(&mutex, 0);
+  if (status) {
+    printf("Mutex initialization failed: %d\n", status);
+    return 1;
+  }
+
+  status = scheduler_start();
+  if (status) {
+    printf("Threads are unschedulable! %d\n", status);
+    return 1;
+  }
+
+  // Should never get here.
+  return 2;
+}
@@ -0,0 +1,117 @@
+/**
+ * @file   main.c
+ *
+ * @brief  Benchmark for the slack left to the idle thread. Every task
+ *         finishes its job well before its budget and calls
+ *         wait_until_next_period(); the idle thread counts the cycles it
+ *         gets and reports them next to the ideal share left by the task set.
+ */
+
+#include <stdio.h>
+#include <syscall_thread.h>
+#include <cycle_count.h>
+
+/** @brief Core clock of the Raspberry Pi 2 */
+#define CPU_HZ 900000000
+
+/** @brief Cycles in one reporting window, one second */
+#define WINDOW_CYCLES CPU_HZ
+
+/** @brief Loop iterations used to calibrate an uninterrupted reading */
+#define CALIBRATE_LOOPS 1000
+
+/** @brief Cpu used by the task set, in parts per thousand */
+#define TASK_SET_LOAD ((5 * 1000) / 100 + (10 * 1000) / 200 + (20 * 1000) / 500)
+
+/** @brief thread user space stack size - 4KB */
+#define USR_STACK_WORDS 1024
+
+uint32_t idle_stack[USR_STACK_WORDS];
+uint32_t thread1_stack[USR_STACK_WORDS];
+uint32_t thread2_stack[USR_STACK_WORDS];
+uint32_t thread3_stack[USR_STACK_WORDS];
+
+/** @brief Idle thread, measures the share of cycles it gets
+ */
+void idle_thread(void) {
+  uint32_t min = 0xffffffff;
+  uint32_t prev = read_cycle_count();
+  int i;
+  for (i = 0; i < CALIBRATE_LOOPS; i++) {
+    uint32_t now = read_cycle_count();
+    if (now - prev < min) min = now - prev;
+    prev = now;
+  }
+  uint32_t threshold = 8 * min + 64;
+
+  uint32_t idle = 0;
+  uint32_t window_start = read_cycle_count();
+  prev = window_start;
+  while(1) {
+    uint32_t now = read_cycle_count();
+    // a longer gap means another thread or the kernel had the cpu
+    if (now - prev < threshold) idle += now - prev;
+    prev = now;
+    if (now - window_start >= WINDOW_CYCLES) {
+      printf("t = %d --- idle: %u/1000 ideal: %u/1000\n", get_time(),
+             (unsigned)(idle / (WINDOW_CYCLES / 1000)),
+             (unsigned)(1000 - TASK_SET_LOAD));
+      idle = 0;
+      window_start = read_cycle_count();
+      prev = window_start;
+    }
+  }
+}
+
+void thread_1(void) {
+  while(1) {
+    spin_wait(5);
+    wait_until_next_period();
+  }
+}
+
+void thread_2(void) {
+  while(1) {
+    spin_wait(10);
+    wait_until_next_period();
+  }
+}
+
+void thread_3(void) {
+  while(1) {
+    spin_wait(20);
+    wait_until_next_period();
+  }
+}
+
+int main(void) {
+  int status;
+  status = thread_init(&idle_thread, &idle_stack[USR_STACK_WORDS-1]);
+  if (status) {
+    printf("Failed to initialize thread library: %d\n", status);
+    return 1;
+  }
+
+  status = thread_create(&thread_1, &thread1_stack[USR_STACK_WORDS-1],
+          0, 20, 100);
+  status += thread_create(&thread_2, &thread2_stack[USR_STACK_WORDS-1],
+          1, 40, 200);
+  status += thread_create(&thread_3, &thread3_stack[USR_STACK_WORDS-1],
+          2, 100, 500);
+
+  if (status) {
+    printf("Failed to create one of the threads!\n");
+    return 1;
+  } else {
+    printf("Successfully created threads! Starting scheduler...\n");
+  }
+
+  status = scheduler_start();
+  if (status) {
+    printf("Threads are unschedulable! %d\n", status);
+    return 1;
+  }
+
+  // Should never get here.
+  return 2;
+}
@@ -0,0 +1,136 @@
+/**
+ * @file   main.c
+ *
+ * @brief  Benchmark for the cost of getting a thread on and off the cpu.
+ *         A background thread spins, stamping the cycle counter into a
+ *         shared variable. A high priority thread with a 2 ms period takes
+ *         two samples per job:
+ *
+ *         irq_to_dispatch: from the spinner's last stamp before the timer
+ *         IRQ that releases the job to the job's first instruction, so the
+ *         IRQ entry, the scheduler pass and the switch in.
+ *
+ *         context_switch: from just before wait_until_next_period() to the
+ *         spinner's first instruction after it, so the syscall and a plain
+ *         switch from one thread to another.
+ *
+ *         The spinner prints the reports, the measuring thread skips its
+ *         samples meanwhile.
+ */
+
+#include <stdio.h>
+#include <syscall_thread.h>
+#include <bench.h>
+
+/** @brief Samples of each kind per report */
+#define SAMPLES 2000
+
+/** @brief thread user space stack size - 1KB */
+#define USR_STACK_WORDS 256
+
+uint32_t idle_stack[USR_STACK_WORDS];
+uint32_t bench_stack[USR_STACK_WORDS];
+uint32_t spin_stack[USR_STACK_WORDS];
+
+uint32_t irq_samples[SAMPLES];
+uint32_t switch_samples[SAMPLES];
+
+bench_t irq_bench = BENCH_INIT("irq_to_dispatch", irq_samples);
+bench_t switch_bench = BENCH_INIT("context_switch", switch_samples);
+
+/** @brief last cycle count the spinner read */
+volatile uint32_t spin_stamp;
+/** @brief set by the spinner on every turn of its loop, cleared by the
+ *         measuring thread before it sleeps */
+volatile uint32_t spinning;
+/** @brief cycle count at which the measuring thread went to sleep */
+volatile uint32_t leave_stamp;
+/** @brief 1 while the spinner still has to time the switch to itself */
+volatile uint32_t leave_pending;
+/** @brief the spinner's last context switch sample, 0 if taken */
+volatile uint32_t switch_cycles;
+/** @brief 1 while the spinner prints the reports */
+volatile uint32_t report;
+
+/** @brief cost of reading the cycle counter twice */
+uint32_t base;
+
+/** @brief Default idle thread which just loops infinitely */
+void idle_thread(void) {
+  while(1);
+}
+
+/** @brief Background thread the measuring thread preempts and switches to */
+void spin_thread(void) {
+  while(1) {
+    if (report) {
+      bench_report(&irq_bench);
+      bench_report(&switch_bench);
+      // the stamp is stale until the next turn
+      spinning = 0;
+      report = 0;
+    }
+    if (leave_pending) {
+      switch_cycles = read_cycle_count() - leave_stamp - base;
+      leave_pending = 0;
+    }
+    spin_stamp = read_cycle_count();
+    spinning = 1;
+  }
+}
+
+/** @brief Measuring thread, one sample of each kind per job */
+void bench_thread(void) {
+  base = bench_overhead();
+  while(1) {
+    uint32_t wake = read_cycle_count();
+    if (!report) {
+      // only a release that preempted the spinner is timed
+      if (spinning) bench_add(&irq_bench, wake - spin_stamp - base);
+      if (switch_cycles) {
+        bench_add(&switch_bench, switch_cycles);
+        switch_cycles = 0;
+      }
+      if (irq_bench.count == SAMPLES && switch_bench.count == SAMPLES) {
+        report = 1;
+      } else {
+        leave_pending = 1;
+      }
+    }
+    spinning = 0;
+    leave_stamp = read_cycle_count();
+    wait_until_next_period();
+  }
+}
+
+int main(void) {
+  int status;
+  status = thread_init(&idle_thread, &idle_stack[USR_STACK_WORDS-1]);
+  if (status) {
+    printf("Failed to initialize thread library: %d\n", status);
+    return 1;
+  }
+
+  status = thread_create(&bench_thread, &bench_stack[USR_STACK_WORDS-1],
+          0, 1, 2);
+  // the spinner overruns its budget at once and runs in the background
+  status += thread_create(&spin_thread, &spin_stack[USR_STACK_WORDS-1],
+          1, 1, 1000);
+  status += thread_set_overrun(1, OVERRUN_DEMOTE, NULL);
+
+  if (status) {
+    printf("Failed to create one of the threads!\n");
+    return 1;
+  } else {
+    printf("Successfully created threads! Starting scheduler...\n");
+  }
+
+  status = scheduler_start();
+  if (status) {
+    printf("Threads are unschedulable! %d\n", status);
+    return 1;
+  }
+
+  // Should never get here.
+  return 2;
+}
@@ -0,0 +1,89 @@
+/**
+ * @file   main.c
+ *
+ * @brief  Benchmark for the round trip cost of a syscall. A thread times
+ *         back to back SWI_PRIORITY syscalls, the cheapest real one, and an
+ *         unused SWI number, which the kernel rejects right after the table
+ *         bounds check. It also times get_priority(), which reads the user
+ *         page instead of trapping. Samples that a tick landed in show up
+ *         in the max.
+ */
+
+#include <stdio.h>
+#include <syscall_thread.h>
+#include <bench.h>
+
+/** @brief Syscalls timed per job for each kind */
+#define SAMPLES 2000
+
+/** @brief thread user space stack size - 1KB */
+#define USR_STACK_WORDS 256
+
+uint32_t idle_stack[USR_STACK_WORDS];
+uint32_t bench_stack[USR_STACK_WORDS];
+
+uint32_t real_samples[SAMPLES];
+uint32_t bad_samples[SAMPLES];
+uint32_t page_samples[SAMPLES];
+
+bench_t real_bench = BENCH_INIT("syscall_null", real_samples);
+bench_t bad_bench = BENCH_INIT("syscall_unknown", bad_samples);
+bench_t page_bench = BENCH_INIT("user_page", page_samples);
+
+/** @brief Default idle thread which just loops infinitely */
+void idle_thread(void) {
+  while(1);
+}
+
+/** @brief Measuring thread, reports once per period */
+void bench_thread(void) {
+  uint32_t base = bench_overhead();
+  while(1) {
+    int i;
+    for (i = 0; i < SAMPLES; i++) {
+      uint32_t start = read_cycle_count();
+      swi_call0(SWI_PRIORITY);
+      bench_add(&real_bench, read_cycle_count() - start - base);
+
+      start = read_cycle_count();
+      swi_call0(SWI_NUM);
+      bench_add(&bad_bench, read_cycle_count() - start - base);
+
+      start = read_cycle_count();
+      get_priority();
+      bench_add(&page_bench, read_cycle_count() - start - base);
+    }
+    bench_report(&real_bench);
+    bench_report(&bad_bench);
+    bench_report(&page_bench);
+    wait_until_next_period();
+  }
+}
+
+int main(void) {
+  int status;
+  status = thread_init(&idle_thread, &idle_stack[USR_STACK_WORDS-1]);
+  if (status) {
+    printf("Failed to initialize thread library: %d\n", status);
+    return 1;
+  }
+
+  status = thread_create(&bench_thread, &bench_stack[USR_STACK_WORDS-1],
+          0, 100, 1000);
+
+  if (status) {
+    printf("Failed to create one of the threads!\n");
+    return 1;
+  } else {
+    printf("Successfully created threads! Starting scheduler...\n");
+  }
+
+  status = scheduler_start();
+  if (status) {
+    printf("Threads are unschedulable! %d\n", status);
+    return 1;
+  }
+
+  // Should never get here.
+  return 2;
+}
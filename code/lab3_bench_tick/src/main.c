@@ -0,0 +1,138 @@
+/**
+ * @file   main.c
+ *
+ * @brief  Benchmark for the cost of one scheduler tick. A high priority
+ *         thread spins on the cycle counter; every gap in the readings is
+ *         time stolen by the timer IRQ. The remaining threads wait for a
+ *         release that never comes within the run, so changing BENCH_TASKS
+ *         in config.mk shows how the tick cost scales with the number of
+ *         waiting tasks. Picking the next task takes the same time for any
+ *         number of tasks, but a scheduler that looks at every waiting task
+ *         to find the released ones still grows linearly with them; only
+ *         a release queue ordered by wakeup makes the whole tick flat.
+ *         Building it at two commits compares the tick cost of two
+ *         scheduler versions.
+ */
+
+#include <stdio.h>
+#include <syscall_thread.h>
+#include <cycle_count.h>
+
+#ifndef BENCH_TASKS
+/** @brief Number of threads, including the measuring thread */
+#define BENCH_TASKS 31
+#endif
+
+#ifndef BENCH_KSTACK
+/** @brief Kernel stack bytes of the filler threads, 0 keeps the default */
+#define BENCH_KSTACK 0
+#endif
+
+/** @brief Number of ticks to sample per job of the measuring thread */
+#define SAMPLE_TICKS 200
+
+/** @brief Loop iterations used to calibrate an uninterrupted reading */
+#define CALIBRATE_LOOPS 1000
+
+/** @brief Period of the filler threads, long enough to never release */
+#define FILLER_PERIOD 60000
+
+/** @brief thread user space stack size - 1KB */
+#define USR_STACK_WORDS 256
+
+uint32_t idle_stack[USR_STACK_WORDS];
+uint32_t thread_stacks[BENCH_TASKS][USR_STACK_WORDS];
+
+/** @brief Default idle thread which just loops infinitely */
+void idle_thread(void) {
+  while(1);
+}
+
+/** @brief Filler thread which does nothing but wait */
+void filler_thread(void) {
+  while(1) {
+    wait_until_next_period();
+  }
+}
+
+/** @brief Cost of one uninterrupted iteration of the sampling loop
+ *
+ *  @return the smallest delta between two cycle counter readings
+ */
+uint32_t calibrate(void) {
+  uint32_t min = 0xffffffff;
+  uint32_t prev = read_cycle_count();
+  int i;
+  for (i = 0; i < CALIBRATE_LOOPS; i++) {
+    uint32_t now = read_cycle_count();
+    if (now - prev < min) min = now - prev;
+    prev = now;
+  }
+  return min;
+}
+
+/** @brief Measuring thread, samples SAMPLE_TICKS ticks every period */
+void bench_thread(void) {
+  // let the filler threads run their first job and go to sleep
+  wait_until_next_period();
+  uint32_t threshold = 8 * calibrate() + 64;
+
+  while(1) {
+    uint32_t ticks = 0;
+    uint32_t min = 0xffffffff;
+    uint32_t max = 0;
+    uint32_t total = 0;
+    uint32_t prev = read_cycle_count();
+
+    while (ticks < SAMPLE_TICKS) {
+      uint32_t now = read_cycle_count();
+      uint32_t gap = now - prev;
+      if (gap > threshold) {
+        ticks++;
+        total += gap;
+        if (gap < min) min = gap;
+        if (gap > max) max = gap;
+      }
+      prev = now;
+    }
+
+    printf("tasks = %d --- tick cycles min: %u avg: %u max: %u\n",
+           BENCH_TASKS, (unsigned)min, (unsigned)(total / ticks),
+           (unsigned)max);
+    wait_until_next_period();
+  }
+}
+
+int main(void) {
+  int status;
+  status = thread_init(&idle_thread, &idle_stack[USR_STACK_WORDS-1]);
+  if (status) {
+    printf("Failed to initialize thread library: %d\n", status);
+    return 1;
+  }
+
+  status = thread_create(&bench_thread, &thread_stacks[0][USR_STACK_WORDS-1],
+          0, 500, 1000);
+  if (BENCH_KSTACK) status += thread_set_kstack(BENCH_KSTACK);
+  int i;
+  for (i = 1; i < BENCH_TASKS; i++) {
+    status += thread_create(&filler_thread,
+            &thread_stacks[i][USR_STACK_WORDS-1], i, 1, FILLER_PERIOD);
+  }
+
+  if (status) {
+    printf("Failed to create one of the threads!\n");
+    return 1;
+  } else {
+    printf("Successfully created threads! Starting scheduler...\n");
+  }
+
+  status = scheduler_start();
+  if (status) {
+    printf("Threads are unschedulable! %d\n", status);
+    return 1;
+  }
+
+  // Should never get here.
+  return 2;
+}
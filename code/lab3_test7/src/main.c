@@ -123,6 +123,14 @@ int main(void) {
     return 1;
   }
 
+  // thread 2 only prints while holding mutex 1, thread 1 can not be kept
+  // waiting longer than that
+  status = thread_hold(1, &mutex1, PRINT_STATUS_TIME_MS * 1000);
+  if (status) {
+    printf("Failed to declare thread 2's critical section: %d\n", status);
+    return 1;
+  }
+
   printf("Successfully created threads! Starting scheduler...\n");
 
   status = scheduler_start();
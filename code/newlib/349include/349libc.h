@@ -11,6 +11,7 @@
 #define _349libc_H_
 
 #include <stdint.h>
+#include <swi_call.h>
 
 /**
  * @brief Starts sampling the ADC periodically, calling the given callback
@@ -22,7 +23,11 @@
  * 
  * @return 0 on success or -1 on failure
  */
-int sample_adc_start(int freq, uint8_t channel, void (*callback)(uint16_t));
+static inline int sample_adc_start(int freq, uint8_t channel,
+                                   void (*callback)(uint16_t)) {
+  return (int)swi_call3(SWI_ADC_START, (uint32_t)freq, channel,
+                        (uint32_t)callback);
+}
 
 
 /**
@@ -30,6 +35,8 @@ int sample_adc_start(int freq, uint8_t channel, void (*callback)(uint16_t));
  *
  * @return 0 on success or -1 on failure
  */
-int sample_adc_stop();
+static inline int sample_adc_stop(void) {
+  return (int)swi_call0(SWI_ADC_STOP);
+}
 
 #endif /* _349libc_H_ */
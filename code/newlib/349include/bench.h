@@ -0,0 +1,81 @@
+/**
+ * @file   bench.h
+ *
+ * @brief  Sample sets for the lab3_bench_* programs. A benchmark adds one
+ *         cycle count per iteration and bench_report() prints the set as a
+ *         "bench <name> n <n> min <c> median <c> p99 <c> max <c>" line,
+ *         which 349util/qemubench.py reads, then starts it over.
+ */
+
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <cycle_count.h>
+
+/** @brief A fixed size set of cycle count samples */
+typedef struct {
+  const char *name;   /**< name printed in the report */
+  uint32_t *sample;   /**< storage for the samples */
+  uint32_t size;      /**< capacity of sample */
+  uint32_t count;     /**< samples taken so far */
+} bench_t;
+
+/** @brief Initializer for a bench_t storing its samples in array `buf` */
+#define BENCH_INIT(name, buf) { name, buf, sizeof(buf) / sizeof(buf[0]), 0 }
+
+/**
+ * @brief Cost of reading the cycle counter twice, to take off every sample
+ *
+ * @return the smallest delta between two cycle counter readings
+ */
+static inline uint32_t bench_overhead(void) {
+  uint32_t min = 0xffffffff;
+  int i;
+  for (i = 0; i < 1000; i++) {
+    uint32_t start = read_cycle_count();
+    uint32_t cycles = read_cycle_count() - start;
+    if (cycles < min) min = cycles;
+  }
+  return min;
+}
+
+/**
+ * @brief Adds a sample unless the set is full
+ *
+ * @param b the sample set
+ * @param cycles the sample
+ * @return 1 once the set is full, 0 otherwise
+ */
+static inline int bench_add(bench_t *b, uint32_t cycles) {
+  if (b->count < b->size) b->sample[b->count++] = cycles;
+  return b->count == b->size;
+}
+
+/**
+ * @brief Prints the distribution of the samples and empties the set. The
+ *        samples are shell sorted in place, which needs no recursion on
+ *        the small thread stacks.
+ *
+ * @param b the sample set
+ */
+static inline void bench_report(bench_t *b) {
+  uint32_t *s = b->sample;
+  uint32_t n = b->count;
+  uint32_t gap, i, j;
+  if (n == 0) return;
+  for (gap = n / 2; gap > 0; gap /= 2) {
+    for (i = gap; i < n; i++) {
+      uint32_t v = s[i];
+      for (j = i; j >= gap && s[j - gap] > v; j -= gap) s[j] = s[j - gap];
+      s[j] = v;
+    }
+  }
+  printf("bench %s n %u min %u median %u p99 %u max %u\n", b->name,
+         (unsigned)n, (unsigned)s[0], (unsigned)s[n / 2],
+         (unsigned)s[(n * 99 + 99) / 100 - 1], (unsigned)s[n - 1]);
+  b->count = 0;
+}
+
+#endif /* _BENCH_H_ */
@@ -0,0 +1,24 @@
+/**
+ * @file   cycle_count.h
+ *
+ * @brief  User mode access to the ARMv7 PMU cycle counter. The kernel enables
+ *         the counter and user access to it at boot.
+ */
+
+#ifndef _CYCLE_COUNT_H_
+#define _CYCLE_COUNT_H_
+
+#include <stdint.h>
+
+/**
+ * @brief Reads the PMU cycle counter
+ *
+ * @return the current cycle count, wraps around every 2^32 cycles
+ */
+static inline uint32_t read_cycle_count(void) {
+  uint32_t ccnt;
+  __asm__ volatile("mrc p15, 0, %0, c9, c13, 0" : "=r" (ccnt));
+  return ccnt;
+}
+
+#endif /* _CYCLE_COUNT_H_ */
@@ -0,0 +1,104 @@
+/**
+ * @file   swi_call.h
+ *
+ * @brief  Inline syscalls: the number goes in r7, up to five arguments in
+ *         r0-r4, and the result comes back in r0. The kernel preserves every
+ *         other register, so a syscall costs the caller nothing but the
+ *         argument moves.
+ */
+
+#ifndef _SWI_CALL_H_
+#define _SWI_CALL_H_
+
+#include <stdint.h>
+#include <swi_num.h>
+
+/**
+ * @brief Makes a syscall without arguments
+ *
+ * @param num SWI number
+ * @return the syscall's result
+ */
+static inline uint32_t swi_call0(uint32_t num) {
+  register uint32_t r0 __asm__("r0");
+  register uint32_t r7 __asm__("r7") = num;
+  __asm__ volatile("swi #0" : "=r" (r0) : "r" (r7) : "memory");
+  return r0;
+}
+
+/**
+ * @brief Makes a syscall with one argument
+ *
+ * @param num SWI number
+ * @param a0 first argument
+ * @return the syscall's result
+ */
+static inline uint32_t swi_call1(uint32_t num, uint32_t a0) {
+  register uint32_t r0 __asm__("r0") = a0;
+  register uint32_t r7 __asm__("r7") = num;
+  __asm__ volatile("swi #0" : "+r" (r0) : "r" (r7) : "memory");
+  return r0;
+}
+
+/**
+ * @brief Makes a syscall with two arguments
+ *
+ * @param num SWI number
+ * @param a0 first argument
+ * @param a1 second argument
+ * @return the syscall's result
+ */
+static inline uint32_t swi_call2(uint32_t num, uint32_t a0, uint32_t a1) {
+  register uint32_t r0 __asm__("r0") = a0;
+  register uint32_t r1 __asm__("r1") = a1;
+  register uint32_t r7 __asm__("r7") = num;
+  __asm__ volatile("swi #0" : "+r" (r0) : "r" (r1), "r" (r7) : "memory");
+  return r0;
+}
+
+/**
+ * @brief Makes a syscall with three arguments
+ *
+ * @param num SWI number
+ * @param a0 first argument
+ * @param a1 second argument
+ * @param a2 third argument
+ * @return the syscall's result
+ */
+static inline uint32_t swi_call3(uint32_t num, uint32_t a0, uint32_t a1,
+                                 uint32_t a2) {
+  register uint32_t r0 __asm__("r0") = a0;
+  register uint32_t r1 __asm__("r1") = a1;
+  register uint32_t r2 __asm__("r2") = a2;
+  register uint32_t r7 __asm__("r7") = num;
+  __asm__ volatile("swi #0" : "+r" (r0) : "r" (r1), "r" (r2), "r" (r7)
+                   : "memory");
+  return r0;
+}
+
+/**
+ * @brief Makes a syscall with five arguments
+ *
+ * @param num SWI number
+ * @param a0 first argument
+ * @param a1 second argument
+ * @param a2 third argument
+ * @param a3 fourth argument
+ * @param a4 fifth argument
+ * @return the syscall's result
+ */
+static inline uint32_t swi_call5(uint32_t num, uint32_t a0, uint32_t a1,
+                                 uint32_t a2, uint32_t a3, uint32_t a4) {
+  register uint32_t r0 __asm__("r0") = a0;
+  register uint32_t r1 __asm__("r1") = a1;
+  register uint32_t r2 __asm__("r2") = a2;
+  register uint32_t r3 __asm__("r3") = a3;
+  register uint32_t r4 __asm__("r4") = a4;
+  register uint32_t r7 __asm__("r7") = num;
+  __asm__ volatile("swi #0" : "+r" (r0)
+                   : "r" (r1), "r" (r2), "r" (r3), "r" (r4), "r" (r7)
+                   : "memory");
+  return r0;
+}
+
+#endif /* _SWI_CALL_H_ */
@@ -1,6 +1,9 @@
 /** @file syscall_thread.h
  *
  *  @brief  Custom syscalls to support real-time threading in 18-349 lab 3.
+ *          Each one is an inline swi, see swi_call.h, except get_time()
+ *          and get_priority(), which read the page the kernel shares with
+ *          user mode, see user_page.h.
  *
  *  @author Hing-On Miu <hmiu@andrew.cmu.edu>
  *  @author Ian Hartwig <ihartwig@andrew.cmu.edu>
@@ -11,6 +14,8 @@
 
 #include <stdint.h>
 #include <mutex.h>
+#include <swi_call.h>
+#include <user_page.h>
 
 
 /** @brief Signature of a thread function
@@ -21,33 +26,304 @@
  */
 typedef void (*thread_fn) (void);
 
+/** @brief Fixed priority scheduling policy */
+#define SCHED_RM  0
+/** @brief Earliest deadline first scheduling policy */
+#define SCHED_EDF 1
+
+/** @brief Most threads alive at once, thread ids are below it */
+#define THREAD_MAX      256
+/** @brief Thread priorities are below it, it is the idle thread's */
+#define THREAD_PRIO_MAX 255
+
+/** @brief Signature of an aperiodic job run by the sporadic server */
+typedef void (*aperiodic_fn) (void *arg);
+
+/** @brief An aperiodic job queued for the sporadic server */
+typedef struct {
+  aperiodic_fn fn;  /**< function to run */
+  void *arg;        /**< its argument */
+} aperiodic_job_t;
+
+/** @brief Overrun policy: suspend the job until its next period */
+#define OVERRUN_SUSPEND 0
+/** @brief Overrun policy: finish the job below every other task */
+#define OVERRUN_DEMOTE  1
+/** @brief Overrun policy: suspend the job and run a handler on the server */
+#define OVERRUN_HANDLER 2
+
+/** @brief Budget enforcement counters of a thread */
+typedef struct {
+  uint32_t overruns;      /**< jobs that ran past their computation time */
+  uint32_t misses;        /**< jobs completed after their deadline or
+                               abandoned by a suspending overrun */
+  uint32_t max_lateness;  /**< worst completion past a deadline (ms) */
+  uint32_t long_holds;    /**< critical sections that ran longer than
+                               thread_hold() declared */
+} thread_stats_t;
+
+/** @brief Buckets of a histogram: bucket 0 counts 0 us, bucket i counts
+ *         values from 2^(i-1) to 2^i - 1 us and the last one everything
+ *         from 2^(HIST_BUCKETS-2) us on */
+#define HIST_BUCKETS 24
+
+/** @brief Log-scale histogram of a time in microseconds */
+typedef struct {
+  uint32_t bucket[HIST_BUCKETS];  /**< samples per bucket */
+  uint32_t max;                   /**< largest sample (us) */
+} hist_t;
+
+/** @brief Timing histograms of a thread's jobs */
+typedef struct {
+  hist_t response;  /**< release to completion */
+  hist_t jitter;    /**< release to first dispatch */
+} thread_hist_t;
+
 /** @brief Initialize the thread library
  *
  *  A user program must call this initializer before attempting to create any
  *  threads or start the scheduler.
  *
  *  @param idle_fn Pointer to a thread function to run when no other threads are
- *  runnable.
+ *  runnable. Every core runs it, pass work_idle to let idle cores run work.
  *  @param idle_stack_start Pointer to the first valid location of idle thread's
- *  stack.
+ *  stack. The idle threads of cores 1-3 get 4KB stacks from the kernel.
  *
  *  @return 0 on success or -1 on failure
  */
-int thread_init(thread_fn idle_fn, uint32_t *idle_stack_start);
+static inline int thread_init(thread_fn idle_fn,
+                              uint32_t *idle_stack_start) {
+  return (int)swi_call2(SWI_THR_INIT, (uint32_t)idle_fn,
+                        (uint32_t)idle_stack_start);
+}
 
 /** @brief Create a new thread running the given function
  *
  *  @param fn Pointer to the function to run in the new thread.
  *  @param stack_start Pointer to the first valid location of this thread's
  *  stack.
- *  @param prio Priority of this thread. Lower number are higher priority.
+ *  @param prio Priority of this thread, below THREAD_PRIO_MAX. Lower number
+ *  are higher priority.
  *  @param C Real time execution time (ms).
  *  @param T Real time task period (ms).
  *
+ *  Threads that share a priority run first come first served. Every thread
+ *  gets the lowest free id, so ids follow creation order until a thread
+ *  exits. Once the scheduler runs, the thread is only created if the task
+ *  set with it still passes the admission test, and it is first released
+ *  at a safe period boundary.
+ *
+ *  @return 0 on success or -1 on failure
+ */
+static inline int thread_create(thread_fn fn, uint32_t *stack_start,
+                                unsigned int prio, unsigned int C,
+                                unsigned int T) {
+  return (int)swi_call5(SWI_THR_CREATE, (uint32_t)fn, (uint32_t)stack_start,
+                        prio, C, T);
+}
+
+/** @brief Set the kernel stack size of the threads created after this call.
+ *
+ *  Each thread has its own kernel stack for its syscalls, 4KB unless this
+ *  is called. Threads that only use the thread and mutex syscalls fit in
+ *  the minimum of 1KB.
+ *
+ *  @param size bytes, a multiple of 8 from 1KB to 64KB
+ *
+ *  @return 0 on success or -1 on failure
+ */
+static inline int thread_set_kstack(unsigned int size) {
+  return (int)swi_call1(SWI_THR_KSTACK, size);
+}
+
+/** @brief End the calling thread.
+ *
+ *  The thread must not hold a mutex. Its id can be reused by
+ *  thread_create() once its current period is over.
+ *
+ *  @return -1 on failure, does not return otherwise
+ */
+static inline int thread_exit(void) {
+  return (int)swi_call0(SWI_THR_EXIT);
+}
+
+/** @brief Body of the sporadic server thread: runs queued jobs forever */
+void aperiodic_server(void);
+
+/** @brief Create the sporadic server, a thread that runs queued aperiodic
+ *         jobs at priority `prio`.
+ *
+ *  The server spends at most C ms of every T ms window on jobs, so the
+ *  admission test treats it like a periodic task with the same C and T.
+ *  Only one server can exist.
+ *
+ *  @param stack_start Pointer to the first valid location of the server's
+ *  stack.
+ *  @param prio Priority of the server.
+ *  @param C Server budget (ms).
+ *  @param T Server replenishment period (ms).
+ *
+ *  @return 0 on success or -1 on failure
+ */
+static inline int server_create(uint32_t *stack_start, unsigned int prio,
+                                unsigned int C, unsigned int T) {
+  return (int)swi_call5(SWI_SRV_CREATE, (uint32_t)&aperiodic_server,
+                        (uint32_t)stack_start, prio, C, T);
+}
+
+/** @brief Queue an aperiodic job for the sporadic server.
+ *
+ *  @param fn function the server will call
+ *  @param arg argument passed to fn
+ *
+ *  @return 0 on success or -1 if the queue is full or there is no server
+ */
+static inline int aperiodic_submit(aperiodic_fn fn, void *arg) {
+  return (int)swi_call2(SWI_APER_SUBMIT, (uint32_t)fn, (uint32_t)arg);
+}
+
+/** @brief Choose what happens when a job of thread `tid` runs longer
+ *         than its computation time C.
+ *
+ *  OVERRUN_SUSPEND, the default, stops the job until its next period.
+ *  OVERRUN_DEMOTE lets it carry on only when no other task is runnable,
+ *  until its next period. OVERRUN_HANDLER suspends it and queues
+ *  handler((void *)tid) on the sporadic server. A job that overruns while
+ *  it holds a mutex is only stopped or demoted once it unlocks the last
+ *  one, and a demoted job runs at any priority it inherits meanwhile.
+ *
+ *  @param tid id of the thread
+ *  @param policy one of the OVERRUN_ policies
+ *  @param handler the handler for OVERRUN_HANDLER, ignored otherwise
+ *
+ *  @return 0 on success or -1 on failure
+ */
+static inline int thread_set_overrun(unsigned int tid, unsigned int policy,
+                                     aperiodic_fn handler) {
+  return (int)swi_call3(SWI_THR_OVERRUN, tid, policy, (uint32_t)handler);
+}
+
+/** @brief Declare the longest critical section thread `tid` runs on
+ *         `mutex`, from mutex_lock() to mutex_unlock() and in cpu time.
+ *
+ *  The admission tests take the blocking a task can see from these
+ *  declarations and the mutex ceilings, so declare every mutex a thread
+ *  uses before scheduler_start(), with some margin for interrupts. A
+ *  thread that may lock a mutex it declared nothing on, any mutex whose
+ *  ceiling is at or above its priority, is taken to block for its whole
+ *  computation time; declare 0 us on such a mutex it never locks. A
+ *  critical section that runs longer is counted in the thread's
+ *  long_holds. Declaring again replaces the old value.
+ *
+ *  @param tid id of the thread
+ *  @param mutex a mutex the thread may lock under its ceiling
+ *  @param us the critical section in microseconds
+ *
+ *  @return 0 on success, -1 for a bad thread or mutex, for a ninth mutex
+ *          of one thread, or once the scheduler runs, if the tasks the
+ *          section can block would not be schedulable
+ */
+static inline int thread_hold(unsigned int tid, mutex_t *mutex,
+                              unsigned int us) {
+  return (int)swi_call3(SWI_THR_HOLD, tid, (uint32_t)mutex, us);
+}
+
+/** @brief Read the budget enforcement counters of thread `tid`.
+ *
+ *  @param tid id of the thread
+ *  @param stats filled with the counters
+ *
+ *  @return 0 on success or -1 on failure
+ */
+static inline int thread_stats(unsigned int tid, thread_stats_t *stats) {
+  return (int)swi_call2(SWI_THR_STATS, tid, (uint32_t)stats);
+}
+
+/** @brief Read the response time and release jitter histograms of thread
+ *         `tid`. Both are measured in microseconds from the scheduler pass
+ *         that released the job, to its completion and to its first
+ *         dispatch.
+ *
+ *  @param tid id of the thread
+ *  @param hist filled with the histograms
+ *
  *  @return 0 on success or -1 on failure
  */
-int thread_create(thread_fn fn, uint32_t *stack_start,
-                  unsigned int prio, unsigned int C, unsigned int T);
+static inline int thread_hist(unsigned int tid, thread_hist_t *hist) {
+  return (int)swi_call2(SWI_THR_HIST, tid, (uint32_t)hist);
+}
+
+/** @brief Print the histograms of every thread over UART, one line per
+ *         histogram: "hist <tid> response|jitter max <us>:" followed by the
+ *         HIST_BUCKETS bucket counts.
+ *
+ *  @return number of threads printed
+ */
+static inline int hist_dump(void) {
+  return (int)swi_call0(SWI_HIST_DUMP);
+}
+
+/** @brief Start the kernel's sampling profiler on every core, or stop it.
+ *         Each sample counts the interrupted pc against the running
+ *         thread and its effective priority.
+ *
+ *  @param interval cycles between samples, at least 9000, 0 to stop
+ *
+ *  @return 0 on success or -1 for a bad interval or a kernel built
+ *          without -DPROFILE
+ */
+static inline int profile_start(unsigned int interval) {
+  return (int)swi_call1(SWI_PROF_START, interval);
+}
+
+/** @brief Print the profiler's samples over UART and start counting
+ *         afresh. 349util/profsym.py turns the output into a profile.
+ *
+ *  @return number of samples printed, or -1 if the kernel was built
+ *          without -DPROFILE
+ */
+static inline int profile_dump(void) {
+  return (int)swi_call0(SWI_PROF_DUMP);
+}
+
+/** @brief Push background work onto the calling core's deque. Idle cores
+ *         run it, taking from their own deque first and stealing from the
+ *         others when it is empty.
+ *
+ *  @param fn function an idle core will call
+ *  @param arg argument passed to fn
+ *
+ *  @return 0 on success or -1 if the deque is full
+ */
+static inline int work_submit(aperiodic_fn fn, void *arg) {
+  return (int)swi_call2(SWI_WORK_SUBMIT, (uint32_t)fn, (uint32_t)arg);
+}
+
+/** @brief Take background work without waiting
+ *
+ *  @param job filled with the work to run
+ *
+ *  @return 0 if job was filled in, -1 if no core had work
+ */
+static inline int work_take(aperiodic_job_t *job) {
+  return (int)swi_call1(SWI_WORK_TAKE, (uint32_t)job);
+}
+
+/** @brief Send the scheduler events the kernel traced since the last dump
+ *         over UART in binary, for 349util/trace2json.py. Nothing else
+ *         should print until it returns. The time it takes is not charged
+ *         to the caller's budget.
+ *
+ *  @return number of events sent, or -1 if the kernel was built without
+ *          -DTRACE
+ */
+static inline int trace_dump(void) {
+  return (int)swi_call0(SWI_TRACE_DUMP);
+}
+
+/** @brief Idle thread that runs submitted work forever, sleeping in wfe
+ *         while there is none. Pass it to thread_init(). */
+void work_idle(void);
 
 /** @brief Initialize the mutex
  *
@@ -58,9 +334,13 @@ int thread_create(thread_fn fn, uint32_t *stack_start,
  *  @param mutex The mutex to act on.
  *  @param max_prio The maximum priority of a thread which could use
  *
- *  @return 0 on success or -1 on failure
+ *  @return 0 on success or -1 on failure, also once the scheduler runs
+ *          if the tasks that may lock it would leave the task set
+ *          unschedulable
  */
-int mutex_init(mutex_t *mutex, unsigned int max_prio);
+static inline int mutex_init(mutex_t *mutex, unsigned int max_prio) {
+  return (int)swi_call2(SWI_MUT_INIT, (uint32_t)mutex, max_prio);
+}
 
 /** @brief Lock the mutex
  *
@@ -70,19 +350,84 @@ int mutex_init(mutex_t *mutex, unsigned int max_prio);
  *
  *  @param mutex The mutex to act on.
  */
-void mutex_lock(mutex_t *mutex);
+static inline void mutex_lock(mutex_t *mutex) {
+  swi_call1(SWI_MUT_LOK, (uint32_t)mutex);
+}
 
 /** @brief Unlock the mutex
  *
  *  @param mutex The mutex to act on.
  */
-void mutex_unlock(mutex_t *mutex);
+static inline void mutex_unlock(mutex_t *mutex) {
+  swi_call1(SWI_MUT_ULK, (uint32_t)mutex);
+}
+
+/** @brief The calling core's record in the user page
+ *  @return its user address, kept by the kernel in TPIDRURO
+ */
+static inline const volatile user_core_page_t *user_core_page(void) {
+  const volatile user_core_page_t *p;
+  __asm__("mrc p15, 0, %0, c13, c0, 3" : "=r" (p));
+  return p;
+}
+
+/** @brief Orders the user page reads against the seq reads around them */
+static inline void user_page_barrier(void) {
+  __asm__ volatile("dmb" : : : "memory");
+}
 
 /** @brief Efficiently waits to run until the next period */
-void wait_until_next_period(void);
+static inline void wait_until_next_period(void) {
+  swi_call0(SWI_WAIT);
+}
+
+/** @brief Get the current time in milliseconds, without a syscall */
+static inline unsigned int get_time(void) {
+  const volatile user_core_page_t *p = user_core_page();
+  unsigned int seq, time;
+  do {
+    seq = p->seq;
+    user_page_barrier();
+    time = p->time;
+    if (p->tickless) {
+      time += (*(volatile uint32_t *)USER_CLOCK_ADDR - p->stamp) / 1000;
+    }
+    user_page_barrier();
+  } while ((seq & 1) || seq != p->seq);
+  return time;
+}
+
+/** @brief Choose the scheduling policy for the task set.
+ *
+ *  SCHED_RM (the default) runs the highest priority thread, with PCP for
+ *  mutexes. SCHED_EDF runs the thread with the earliest absolute deadline,
+ *  with thread priorities used as SRP preemption levels (give shorter
+ *  periods lower numbers) and mutex ceilings expressed in the same
+ *  priorities. Must be called before scheduler_start().
+ *
+ *  @param policy SCHED_RM or SCHED_EDF
+ *
+ *  @return 0 on success or -1 on failure
+ */
+static inline int scheduler_set_policy(unsigned int policy) {
+  return (int)swi_call1(SWI_SCHD_POLICY, policy);
+}
 
-/** @brief Get the current time in milliseconds */
-unsigned int get_time(void);
+/** @brief Run the admission test of the selected policy on the threads
+ *         created so far, without starting the scheduler.
+ *
+ *  Fixed priority uses exact response time analysis including PCP blocking
+ *  and scheduler overhead; EDF reports each thread's period.
+ *
+ *  @param wcrt  array of THREAD_MAX entries filled with the worst case
+ *               response time of each thread id in microseconds, 0 for
+ *               unused ids
+ *
+ *  @return 0 if the task set is schedulable or -1 if not
+ */
+static inline int scheduler_admit(uint32_t *wcrt) {
+  return (int)swi_call1(SWI_SCHD_ADMIT, (uint32_t)wcrt);
+}
 
 /** @brief Allow the kernel to start running the added task set.
  *
@@ -90,19 +435,55 @@ unsigned int get_time(void);
  *  will test that a task set with this new task is scheduleable before running
  *  and may return an error if this is not the case.
  *
+ *  With more than one core the tasks are first packed onto the cores by
+ *  utilization, each core checked with the admission test.
+ *
  *  @return 0 on success or -1 on failure
  */
-int scheduler_start(void);
+static inline int scheduler_start(void) {
+  return (int)swi_call0(SWI_SCHD_START);
+}
+
+/** @brief Get the time since boot in microseconds, without a syscall
+ *
+ *  Reads the 1MHz system timer, which runs from power on whether or not the
+ *  scheduler has started and does not wrap for over 500000 years.
+ *
+ *  @return microseconds since boot
+ */
+static inline uint64_t get_time_us(void) {
+  volatile uint32_t *clock = (volatile uint32_t *)USER_CLOCK_ADDR;
+  uint32_t hi, lo;
+  //the high word must not have moved while the low word was read
+  do {
+    hi = clock[1];
+    lo = clock[0];
+  } while (hi != clock[1]);
+  return ((uint64_t)hi << 32) | lo;
+}
 
-/** @brief Get the effective priority of the current running thread
+/** @brief Get the effective priority of the current running thread,
+ *         without a syscall
  *  @return The thread's effective priority for scheduling
  */
-unsigned int get_priority(void);
+static inline unsigned int get_priority(void) {
+  const volatile user_core_page_t *p = user_core_page();
+  unsigned int seq, priority;
+  do {
+    seq = p->seq;
+    user_page_barrier();
+    priority = p->priority;
+    user_page_barrier();
+  } while ((seq & 1) || seq != p->seq);
+  return priority;
+}
 
 /** @brief Spin the calling thread for at least `ms` milliseconds
  *         Call may return later, depending on thread scheduling
  *  @return Void
  */
-void spin_wait(unsigned ms);
+static inline void spin_wait(unsigned ms) {
+  swi_call1(SWI_SPIN_WAIT, ms);
+}
 
 #endif /* _SYSCALL_THREAD_H_ */
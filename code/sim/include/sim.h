@@ -0,0 +1,67 @@
+/**
+ * @file   sim.h
+ *
+ * @brief  What the simulator driver uses of the kernel and of hw.c. The
+ *         kernel headers are built on kstdint.h, which clashes with the
+ *         host libc, so the driver declares the few calls it makes here
+ *         with plain C types; they must match syscalls.h.
+ *
+ * @date   10.16.2026
+ * @author yanyingz
+ */
+
+#ifndef _SIM_H_
+#define _SIM_H_
+
+#include <mutex.h>
+
+/** @brief SCHED_RM of syscalls.h */
+#define SIM_SCHED_RM  0
+/** @brief SCHED_EDF of syscalls.h */
+#define SIM_SCHED_EDF 1
+
+/** @brief OVERRUN_DEMOTE of syscalls.h */
+#define SIM_OVERRUN_DEMOTE 1
+
+/** @brief Index of the resume pc in a thread's frame, LR_IRQ of the
+ *         scheduler */
+#define SIM_FRAME_PC 18
+
+/** @brief Budget enforcement counters, thread_stats_t of syscalls.h */
+typedef struct {
+  unsigned int overruns;
+  unsigned int misses;
+  unsigned int max_lateness;
+  unsigned int long_holds;
+} sim_stats_t;
+
+int thread_init(void (*idle_fn)(void), unsigned int *idle_stack_start);
+int thread_create(void (*fn)(void), unsigned int *stack_start,
+                  unsigned int prio, unsigned int C, unsigned int T);
+int thread_stats(unsigned int tid, sim_stats_t *stats);
+int thread_hold(unsigned int tid, mutex_t *mutex, unsigned int us);
+int thread_set_overrun(unsigned int tid, unsigned int policy,
+                       void (*handler)(void *arg));
+int mutex_init(mutex_t *mutex, unsigned int max_prio);
+void mutex_lock(mutex_t *mutex);
+void mutex_unlock(mutex_t *mutex);
+void wait_until_next_period(void);
+int scheduler_set_policy(unsigned int policy);
+int scheduler_start(void);
+unsigned int *call_scheduler(unsigned int *sp);
+unsigned int *dispatch(unsigned int *sp);
+
+/** @brief set by a syscall that gave up the cpu, swi_asm_handler then
+ *         calls dispatch() */
+extern unsigned int resched_pending[];
+
+/** @brief simulated system timer, in microseconds */
+extern unsigned int sim_now;
+/** @brief system timer value of the pending alarm */
+extern unsigned int sim_alarm;
+/** @brief 1 while an alarm is armed */
+extern unsigned int sim_alarm_on;
+/** @brief frame scheduler_start() left the kernel through */
+extern unsigned int *sim_frame;
+
+#endif /* _SIM_H_ */
@@ -0,0 +1,119 @@
+/**
+ * @file   hw.c
+ *
+ * @brief  The hardware under the scheduler, for the host simulator. Time is
+ *         the simulated system timer, IRQ masking and the memory ordering
+ *         routines do nothing on a single host thread, and the FPU is never
+ *         touched. Built like a kernel source: freestanding, against the
+ *         kernel headers.
+ *
+ * @date   10.16.2026
+ * @author yanyingz
+ */
+
+#include <kstdint.h>
+#include <arm.h>
+#include <timer.h>
+#include <systimer.h>
+#include <smp.h>
+#include <supervisor.h>
+#include <BCM2836.h>
+
+/**@brief the thread context arena kernel.ld reserves after the stacks*/
+__asm__(".bss\n"
+        ".balign 64\n"
+        ".globl __tcb_low\n"
+        "__tcb_low:\n"
+        ".space 0x400000\n"
+        ".globl __tcb_top\n"
+        "__tcb_top:\n"
+        ".text\n");
+
+/**@brief simulated system timer, in microseconds*/
+uint32_t sim_now;
+/**@brief system timer value of the pending alarm*/
+uint32_t sim_alarm;
+/**@brief 1 while an alarm is armed*/
+uint32_t sim_alarm_on;
+/**@brief frame scheduler_start() left the kernel through*/
+uint32_t *sim_frame;
+
+void delay_cycles(uint32_t count){
+}
+
+void disable_interrupts(void){
+}
+
+void enable_interrupts(void){
+}
+
+uint32_t read_cycle_count(void){
+  return sim_now * CPU_MHZ;
+}
+
+uint32_t get_core_id(void){
+  return 0;
+}
+
+void send_event(void){
+}
+
+void wait_event(void){
+}
+
+void spin_lock(volatile uint32_t *lock){
+  *lock = 1;
+}
+
+void spin_unlock(volatile uint32_t *lock){
+  *lock = 0;
+}
+
+int compare_and_swap(volatile uint32_t *addr, uint32_t old_val,
+                     uint32_t new_val){
+  if (*addr != old_val) return 0;
+  *addr = new_val;
+  return 1;
+}
+
+void memory_barrier(void){
+}
+
+uint32_t read_fpexc(void){
+  return 0;
+}
+
+void write_fpexc(uint32_t fpexc){
+}
+
+void vfp_save(uint32_t *regs){
+}
+
+void vfp_restore(uint32_t *regs){
+}
+
+void timer_start(int freq){
+}
+
+uint32_t systimer_read(void){
+  return sim_now;
+}
+
+void systimer_set_alarm(uint32_t us){
+  sim_alarm = us;
+  sim_alarm_on = 1;
+}
+
+void systimer_stop(void){
+  sim_alarm_on = 0;
+}
+
+void smp_timer_start(uint32_t core, uint32_t freq){
+}
+
+void smp_ipi_send(uint32_t core){
+}
+
+void idle_enter(uint32_t *frame){
+  sim_frame = frame;
+}
@@ -0,0 +1,594 @@
+/**
+ * @file   sim.c
+ *
+ * @brief  Host simulator driving the real scheduler. Each task runs a
+ *         script of compute, lock and unlock steps per job. The driver
+ *         plays user mode and the IRQ and SWI entry code: it runs the
+ *         current task's script against simulated time, makes the task's
+ *         syscalls, and calls call_scheduler() on every tick (or alarm
+ *         with -DTICKLESS) and dispatch() when a syscall asks for it. The
+ *         thread that runs is read from the pc in the frame the scheduler
+ *         returns, so every task is created with a fake entry point.
+ *
+ *         Along the way it checks that every job meets its deadline, that
+ *         a mutex is only granted above the ceiling of every mutex other
+ *         tasks hold, and that no job waits on lower priority tasks (under
+ *         EDF, ones whose job also has a later deadline) for longer than
+ *         their longest critical section it can be blocked by.
+ *
+ * @date   10.16.2026
+ * @author yanyingz
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sim.h>
+
+/** @brief most tasks in a task set, ids must stay below THREAD_MAX */
+#define MAX_TASKS 250
+/** @brief most steps in one task's script */
+#define MAX_STEPS 64
+/** @brief most mutexes in a task set */
+#define MAX_MUTEXES 64
+/** @brief most violations printed */
+#define MAX_REPORTS 10
+/** @brief priority given to the idle task when comparing */
+#define IDLE_PRIO 256
+/** @brief fake entry points, the frame pc tells the threads apart */
+#define PC_BASE 0x1000
+#define PC_IDLE 0x0ff0
+/** @brief simulated microseconds per scheduler millisecond */
+#define US_PER_MS 1000
+
+/** @brief script steps */
+#define STEP_RUN    0
+#define STEP_LOCK   1
+#define STEP_UNLOCK 2
+#define STEP_OVERRUN 3
+
+typedef struct {
+  int kind;
+  unsigned int arg;     /**< microseconds to run, or the mutex */
+} step_t;
+
+typedef struct {
+  char name[32];
+  unsigned int prio, C, T;
+  step_t step[MAX_STEPS];
+  int steps;
+  /* longest critical section each priority level can be blocked by */
+  unsigned long long bound;
+  /* run state */
+  int pc;                     /**< next step */
+  unsigned long long left;    /**< microseconds left in a run step */
+  int want;                   /**< mutex being locked, -1 if none */
+  unsigned long long jobs;    /**< completed or abandoned jobs */
+  unsigned long long ran;     /**< microseconds the current job ran */
+  unsigned long long late;    /**< of those, past <C> holding no mutex */
+  unsigned long long misses;
+  int demote;                 /**< overruns demote rather than suspend */
+  int undeclared;             /**< critical sections left undeclared */
+  unsigned int overruns;      /**< overruns the kernel enforced */
+  unsigned long long resp_max;
+  unsigned long long block;   /**< inversion of the current job */
+  unsigned long long block_max;
+} task_t;
+
+typedef struct {
+  char name[32];
+  unsigned int ceiling;
+  mutex_t mutex;
+  int holder;                 /**< task holding it, -1 if free */
+} sim_mutex_t;
+
+task_t tasks[MAX_TASKS];
+int task_num;
+sim_mutex_t mutexes[MAX_MUTEXES];
+int mutex_num;
+unsigned int policy = SIM_SCHED_RM;
+
+unsigned long long now;
+unsigned long long violations;
+unsigned long long passes;
+int quiet;
+
+unsigned int idle_stack[16];
+unsigned int task_stack[16];
+
+/** @brief the kernel's console is stdout */
+int printk(const char *fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  int n = vprintf(fmt, args);
+  va_end(args);
+  return n;
+}
+
+/** @brief report a broken invariant */
+void violation(const char *what, int task) {
+  violations++;
+  if (violations <= MAX_REPORTS) {
+    printf("t=%lluus: %s: %s\n", now, tasks[task].name, what);
+  }
+}
+
+int find_mutex(const char *name) {
+  int m;
+  for (m = 0; m < mutex_num; m++) {
+    if (strcmp(mutexes[m].name, name) == 0) return m;
+  }
+  return -1;
+}
+
+/** @brief read a task set, see tasksets/README for the format
+ *  @return 0 on success, -1 after printing an error */
+int parse(const char *path) {
+  FILE *f = fopen(path, "r");
+  if (f == NULL) {
+    perror(path);
+    return -1;
+  }
+  char line[1024];
+  int n = 0;
+  while (fgets(line, sizeof(line), f) != NULL) {
+    n++;
+    char *tok = strtok(line, " \t\r\n");
+    if (tok == NULL || tok[0] == '#') continue;
+    if (strcmp(tok, "policy") == 0) {
+      tok = strtok(NULL, " \t\r\n");
+      if (tok != NULL && strcmp(tok, "rm") == 0) {
+        policy = SIM_SCHED_RM;
+      } else if (tok != NULL && strcmp(tok, "edf") == 0) {
+        policy = SIM_SCHED_EDF;
+      } else {
+        goto bad;
+      }
+    } else if (strcmp(tok, "mutex") == 0) {
+      char *name = strtok(NULL, " \t\r\n");
+      char *ceiling = strtok(NULL, " \t\r\n");
+      if (name == NULL || ceiling == NULL || mutex_num == MAX_MUTEXES) goto bad;
+      sim_mutex_t *m = &mutexes[mutex_num++];
+      snprintf(m->name, sizeof(m->name), "%s", name);
+      m->ceiling = atoi(ceiling);
+      m->holder = -1;
+    } else if (strcmp(tok, "demote") == 0) {
+      char *name = strtok(NULL, " \t\r\n");
+      int i;
+      for (i = 0; name != NULL && i < task_num; i++) {
+        if (strcmp(tasks[i].name, name) == 0) break;
+      }
+      if (name == NULL || i == task_num) goto bad;
+      tasks[i].demote = 1;
+    } else if (strcmp(tok, "undeclared") == 0) {
+      char *name = strtok(NULL, " \t\r\n");
+      int i;
+      for (i = 0; name != NULL && i < task_num; i++) {
+        if (strcmp(tasks[i].name, name) == 0) break;
+      }
+      if (name == NULL || i == task_num) goto bad;
+      tasks[i].undeclared = 1;
+    } else if (strcmp(tok, "task") == 0) {
+      if (task_num == MAX_TASKS) goto bad;
+      task_t *t = &tasks[task_num++];
+      char *name = strtok(NULL, " \t\r\n");
+      char *prio = strtok(NULL, " \t\r\n");
+      char *C = strtok(NULL, " \t\r\n");
+      char *T = strtok(NULL, " \t\r\n");
+      if (T == NULL) goto bad;
+      snprintf(t->name, sizeof(t->name), "%s", name);
+      t->prio = atoi(prio);
+      t->C = atoi(C);
+      t->T = atoi(T);
+      t->want = -1;
+      while ((tok = strtok(NULL, " \t\r\n")) != NULL) {
+        char *arg = strtok(NULL, " \t\r\n");
+        if (arg == NULL || t->steps == MAX_STEPS) goto bad;
+        step_t *s = &t->step[t->steps++];
+        if (strcmp(tok, "run") == 0 || strcmp(tok, "overrun") == 0) {
+          s->kind = (tok[0] == 'r') ? STEP_RUN : STEP_OVERRUN;
+          s->arg = atoi(arg);
+          if (s->arg == 0) goto bad;
+        } else if (strcmp(tok, "lock") == 0 || strcmp(tok, "unlock") == 0) {
+          int m = find_mutex(arg);
+          if (m < 0) {
+            fprintf(stderr, "%s:%d: unknown mutex %s\n", path, n, arg);
+            fclose(f);
+            return -1;
+          }
+          if (mutexes[m].ceiling > t->prio) {
+            fprintf(stderr, "%s:%d: %s is above the ceiling of %s\n",
+                    path, n, t->name, arg);
+            fclose(f);
+            return -1;
+          }
+          s->kind = (tok[0] == 'l') ? STEP_LOCK : STEP_UNLOCK;
+          s->arg = m;
+        } else {
+          goto bad;
+        }
+      }
+    } else {
+      goto bad;
+    }
+  }
+  fclose(f);
+  return 0;
+bad:
+  fprintf(stderr, "%s:%d: bad line\n", path, n);
+  fclose(f);
+  return -1;
+}
+
+/** @brief worst blocking each task may see under PCP or SRP: the longest
+ *         outermost critical section of a lower priority task that holds a
+ *         mutex with a ceiling at or above the task's priority */
+void compute_bounds(void) {
+  int i, j, k;
+  for (i = 0; i < task_num; i++) {
+    for (j = 0; j < task_num; j++) {
+      if (tasks[j].prio <= tasks[i].prio) continue;
+      int depth = 0;
+      int blocks = 0;
+      unsigned long long len = 0;
+      for (k = 0; k < tasks[j].steps; k++) {
+        step_t *s = &tasks[j].step[k];
+        if (s->kind == STEP_LOCK) {
+          if (depth++ == 0) {
+            len = 0;
+            blocks = 0;
+          }
+          if (mutexes[s->arg].ceiling <= tasks[i].prio) blocks = 1;
+        } else if (s->kind == STEP_UNLOCK) {
+          if (--depth == 0 && blocks && len > tasks[i].bound) {
+            tasks[i].bound = len;
+          }
+        } else if (depth > 0) {
+          len += s->arg;
+        }
+      }
+    }
+  }
+}
+
+/** @brief declare each task's longest critical section on every mutex
+ *  it may lock, from the lock step to the matching unlock, 0 on the ones
+ *  its script never locks
+ *  @return 0 on success, -1 after printing an error */
+int declare_holds(void) {
+  int i, k, m, n;
+  for (i = 0; i < task_num; i++) {
+    task_t *t = &tasks[i];
+    if (t->undeclared) continue;
+    for (m = 0; m < mutex_num; m++) {
+      if (mutexes[m].ceiling > t->prio) continue;
+      unsigned int us = 0;
+      for (k = 0; k < t->steps; k++) {
+        if (t->step[k].kind != STEP_LOCK || t->step[k].arg != m) continue;
+        unsigned int len = 0;
+        for (n = k + 1; n < t->steps; n++) {
+          step_t *s = &t->step[n];
+          if (s->kind == STEP_UNLOCK && s->arg == m) break;
+          if (s->kind == STEP_RUN || s->kind == STEP_OVERRUN) len += s->arg;
+        }
+        if (len > us) us = len;
+      }
+      if (thread_hold(i, &mutexes[m].mutex, us)) {
+        fprintf(stderr, "thread_hold failed for %s on %s\n", t->name,
+                mutexes[m].name);
+        return -1;
+      }
+    }
+  }
+  return 0;
+}
+
+/** @brief the task a frame resumes, -1 for idle */
+int frame_task(unsigned int *sp) {
+  unsigned int pc = sp[SIM_FRAME_PC];
+  if (pc == PC_IDLE) return -1;
+  return (pc - PC_BASE) / 4;
+}
+
+/** @brief what swi_asm_handler does on the way out of a syscall */
+unsigned int *syscall_return(unsigned int *sp) {
+  if (resched_pending[0]) {
+    resched_pending[0] = 0;
+    passes++;
+    sp = dispatch(sp);
+  }
+  return sp;
+}
+
+/** @brief the task now holds the mutex it wanted: check it got it
+ *         through the ceiling rule, allowing for priority it may have
+ *         inherited from any blocked task */
+void acquired(int i) {
+  task_t *t = &tasks[i];
+  sim_mutex_t *m = &mutexes[t->want];
+  unsigned int prio = t->prio;
+  int j;
+  for (j = 0; j < task_num; j++) {
+    if (j != i && tasks[j].want >= 0 && tasks[j].prio < prio) {
+      prio = tasks[j].prio;
+    }
+  }
+  if (m->holder >= 0) violation("granted a mutex another task holds", i);
+  if (m->mutex.thread != i) violation("kernel has another owner on record", i);
+  for (j = 0; j < mutex_num; j++) {
+    if (mutexes[j].holder >= 0 && mutexes[j].holder != i &&
+        mutexes[j].ceiling <= prio) {
+      violation("granted a mutex at or below the system ceiling", i);
+    }
+  }
+  m->holder = i;
+  t->want = -1;
+}
+
+/** @brief the current job of a task ends */
+void job_complete(int i) {
+  task_t *t = &tasks[i];
+  unsigned long long release = t->jobs * t->T * US_PER_MS;
+  unsigned long long resp = now - release;
+  if (resp > t->resp_max) t->resp_max = resp;
+  if (resp > (unsigned long long)t->T * US_PER_MS) {
+    t->misses++;
+    violation("missed its deadline", i);
+  }
+  if (t->block > t->bound) {
+    violation("blocked by lower priority tasks beyond one critical section", i);
+  }
+  if (t->block > t->block_max) t->block_max = t->block;
+  t->block = 0;
+  t->ran = 0;
+  t->late = 0;
+  t->jobs++;
+  t->pc = 0;
+}
+
+/** @brief a scheduler pass ran while the task was running: if the kernel
+ *         suspended it for overrunning its budget, the job is abandoned
+ *         and the rest of the script runs as the next job, a demoted job
+ *         just carries on */
+void check_overrun(int i) {
+  task_t *t = &tasks[i];
+  sim_stats_t stats;
+  thread_stats(i, &stats);
+  if (stats.overruns == t->overruns) return;
+  t->overruns = stats.overruns;
+  if (t->ran <= (unsigned long long)t->C * US_PER_MS) {
+    violation("budget enforced on a job within its computation time", i);
+  }
+#ifdef TICKLESS
+  //the alarm is armed for the microsecond the budget runs out
+  if (t->late > 1) violation("budget enforced after it ran out", i);
+#endif
+  if (t->demote) return;
+  t->block = 0;
+  t->ran = 0;
+  t->late = 0;
+  t->jobs++;
+}
+
+/** @brief run the task for dt microseconds */
+void run_task(int i, unsigned long long dt) {
+  task_t *t = &tasks[i];
+  unsigned long long C = (unsigned long long)t->C * US_PER_MS;
+  unsigned long long from = (t->ran > C) ? t->ran : C;
+  int m;
+  t->ran += dt;
+  t->left -= dt;
+  if (t->ran <= from) return;
+  for (m = 0; m < mutex_num; m++) {
+    if (mutexes[m].holder == i) return;
+  }
+  t->late += t->ran - from;
+}
+
+/** @brief charge dt microseconds of the running task to every released
+ *         job of a higher priority task it holds up, under EDF only to the
+ *         ones that also have an earlier deadline */
+void account(int cur, unsigned long long dt) {
+  unsigned int prio = (cur < 0) ? IDLE_PRIO : tasks[cur].prio;
+  unsigned long long deadline = ~0ULL;
+  if (cur >= 0) deadline = (tasks[cur].jobs + 1) * tasks[cur].T * US_PER_MS;
+  int i;
+  for (i = 0; i < task_num; i++) {
+    task_t *t = &tasks[i];
+    if (t->prio >= prio || now < t->jobs * t->T * US_PER_MS) continue;
+    if (policy == SIM_SCHED_EDF &&
+        (t->jobs + 1) * t->T * US_PER_MS >= deadline) {
+      continue;
+    }
+    t->block += dt;
+  }
+}
+
+/** @brief when the next timer IRQ fires */
+unsigned long long next_irq(unsigned long long tick) {
+#ifdef TICKLESS
+  if (!sim_alarm_on) return ~0ULL;
+  //the alarm is a 32-bit compare, it is never more than 2^31 us away
+  unsigned long long at = now + (unsigned int)(sim_alarm - sim_now);
+  if ((int)(sim_alarm - sim_now) <= 0) at = now;
+  return at;
+#else
+  return tick;
+#endif
+}
+
+/** @brief run the task set for the given simulated time
+ *  @param check 0 to skip the invariant bookkeeping */
+void run(unsigned long long end, int check) {
+  unsigned int *sp = sim_frame;
+  unsigned long long tick = US_PER_MS;
+  while (now < end) {
+    int cur = frame_task(sp);
+    task_t *t = (cur < 0) ? NULL : &tasks[cur];
+    if (t != NULL) {
+      if (t->want >= 0 && check) acquired(cur);
+      t->want = -1;
+      if (t->pc == t->steps) {
+        job_complete(cur);
+        wait_until_next_period();
+        sp = syscall_return(sp);
+        continue;
+      }
+      step_t *s = &t->step[t->pc];
+      if (s->kind == STEP_LOCK) {
+        t->want = s->arg;
+        t->pc++;
+        mutex_lock(&mutexes[s->arg].mutex);
+        if (!resched_pending[0]) {
+          if (check) acquired(cur);
+          t->want = -1;
+        }
+        sp = syscall_return(sp);
+        continue;
+      }
+      if (s->kind == STEP_UNLOCK) {
+        mutexes[s->arg].holder = -1;
+        t->pc++;
+        mutex_unlock(&mutexes[s->arg].mutex);
+        sp = syscall_return(sp);
+        //an overrun deferred while the task held mutexes is enforced here
+        if (check) check_overrun(cur);
+        continue;
+      }
+      //an injected overrun only lengthens the first job
+      if (s->kind == STEP_OVERRUN && t->jobs > 0) {
+        t->pc++;
+        continue;
+      }
+      if (t->left == 0) t->left = s->arg;
+    }
+
+    unsigned long long irq = next_irq(tick);
+    unsigned long long stop = (irq < end) ? irq : end;
+    if (t != NULL && now + t->left < stop) stop = now + t->left;
+    //scheduler_start() leaves to the idle task until the first tick, that
+    //wait is not blocking by any task
+    if (check && passes > 0) account(cur, stop - now);
+    if (t != NULL) {
+      run_task(cur, stop - now);
+      if (t->left == 0) t->pc++;
+    }
+    now = stop;
+    sim_now = (unsigned int)now;
+    if (now == irq) {
+      passes++;
+      sp = call_scheduler(sp);
+      tick += US_PER_MS;
+      if (check && t != NULL) check_overrun(cur);
+    }
+  }
+}
+
+void usage(const char *prog) {
+  fprintf(stderr, "usage: %s [-t ms] [-b] [-q] taskset\n"
+          "  -t ms  simulated time, default 1000000 ms\n"
+          "  -b     benchmark: skip the invariant checks\n"
+          "  -q     print only the summary\n", prog);
+}
+
+int main(int argc, char **argv) {
+  unsigned long long ms = 1000000;
+  int check = 1;
+  const char *path = NULL;
+  int i;
+  for (i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+      ms = strtoull(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "-b") == 0) {
+      check = 0;
+    } else if (strcmp(argv[i], "-q") == 0) {
+      quiet = 1;
+    } else if (argv[i][0] != '-' && path == NULL) {
+      path = argv[i];
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  //sim_now is the 32-bit system timer, keep it from wrapping
+  if (path == NULL || ms == 0 || ms > 4000000) {
+    usage(argv[0]);
+    return 2;
+  }
+  if (parse(path)) return 2;
+  compute_bounds();
+
+  if (thread_init((void (*)(void))PC_IDLE, &idle_stack[15])) {
+    fprintf(stderr, "thread_init failed\n");
+    return 2;
+  }
+  for (i = 0; i < mutex_num; i++) {
+    if (mutex_init(&mutexes[i].mutex, mutexes[i].ceiling)) {
+      fprintf(stderr, "mutex_init failed for %s\n", mutexes[i].name);
+      return 2;
+    }
+  }
+  for (i = 0; i < task_num; i++) {
+    task_t *t = &tasks[i];
+    if (thread_create((void (*)(void))(unsigned long)(PC_BASE + 4 * i),
+                      &task_stack[15], t->prio, t->C, t->T)) {
+      fprintf(stderr, "thread_create failed for %s\n", t->name);
+      return 2;
+    }
+    if (t->demote && thread_set_overrun(i, SIM_OVERRUN_DEMOTE, NULL)) {
+      fprintf(stderr, "thread_set_overrun failed for %s\n", t->name);
+      return 2;
+    }
+  }
+  if (declare_holds()) return 2;
+  if (scheduler_set_policy(policy) || scheduler_start()) {
+    printf("%s: rejected by the admission test\n", path);
+    return 2;
+  }
+
+  struct timespec t0, t1;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  run(ms * US_PER_MS, check);
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  double secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+  //the kernel counts a miss for every late job and every abandoned one
+  for (i = 0; check && i < task_num; i++) {
+    sim_stats_t stats;
+    thread_stats(i, &stats);
+    unsigned int abandoned = tasks[i].demote ? 0 : tasks[i].overruns;
+    if (stats.misses != tasks[i].misses + abandoned) {
+      violation("kernel miss count disagrees with the simulation", i);
+    }
+    if (stats.long_holds) {
+      violation("kernel measured a critical section beyond its declaration",
+                i);
+    }
+  }
+
+  if (!quiet) {
+    printf("%-12s %4s %5s %6s %10s %6s %6s %10s %10s %10s %8s\n", "task",
+           "prio", "C", "T", "jobs", "miss", "kmiss", "resp_us", "block_us",
+           "bound_us", "overrun");
+    for (i = 0; i < task_num; i++) {
+      task_t *t = &tasks[i];
+      sim_stats_t stats;
+      thread_stats(i, &stats);
+      printf("%-12s %4u %5u %6u %10llu %6llu %6u %10llu %10llu %10llu %8u\n",
+             t->name, t->prio, t->C, t->T, t->jobs, t->misses, stats.misses,
+             t->resp_max, t->block_max, t->bound, stats.overruns);
+    }
+  }
+  printf("%s: %llu ms simulated, %llu scheduler passes in %.3f s, "
+         "%.0f ticks/s, %.0f ns/pass\n", path, ms, passes, secs, ms / secs,
+         secs * 1e9 / passes);
+  if (!check) return 0;
+  if (violations) {
+    printf("%llu invariant violations\n", violations);
+    return 1;
+  }
+  printf("invariants hold\n");
+  return 0;
+}